@@ -20,6 +20,7 @@ extern "C" {
 #define static_const_spi_transfer_type_t static const spi_transfer_type_t
 #define uint32_t_movable_ptr_t uint32_t * movable
 #define uint8_t_movable_ptr_t uint8_t * movable
+#define uint8_t_unsafe_ptr_t uint8_t * unsafe
 #endif
 
 /** This type indicates what clocking mode a SPI component should use */
@@ -59,5 +60,8 @@ typedef struct spi_master_miso_capture_timing_t {
 #include "spi_master_sync.h"
 #include "spi_master_async.h"
 #include "spi_slave.h"
+#include "spi_flash_cache.h"
+#include "spi_reg_map.h"
+#include "spi_buffer_pool.h"
 
 #endif // _spi_h_
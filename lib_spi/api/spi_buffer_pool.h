@@ -0,0 +1,127 @@
+// Copyright 2025 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+
+/** The largest total number of buffers a buffer pool task may hold, over
+ *  all of its size classes.
+ */
+#define SPI_BUFFER_POOL_MAX_BUFFERS 16
+
+/** The number of words of pool memory needed for a size class of
+ *  num_buffers buffers of buffer_bytes bytes each. The pool_words
+ *  parameter of spi_buffer_pool() is the sum of this over the classes.
+ */
+#define SPI_BUFFER_POOL_WORDS(buffer_bytes, num_buffers) \
+  ((((buffer_bytes) + 3) / 4) * (num_buffers))
+
+/** This type describes one size class of a buffer pool task. Each buffer
+ *  starts on a word boundary, so it may be used for 8-bit or 32-bit
+ *  transfers.
+ */
+typedef struct spi_buffer_pool_class_t {
+  unsigned buffer_bytes;  ///< The size of each buffer in the class, in bytes.
+  unsigned num_buffers;   ///< The number of buffers in the class.
+} spi_buffer_pool_class_t;
+
+/** This type holds the counts kept by a buffer pool task for one size
+ *  class since it started.
+ */
+typedef struct spi_buffer_pool_stats_t {
+  uint32_t in_use;      ///< Buffers of the class lent out now.
+  uint32_t high_water;  ///< The most buffers of the class lent out at once.
+  uint32_t allocs;      ///< Buffers of the class lent out in total.
+  uint32_t failures;    ///< Requests for which this was the smallest class
+                        ///< large enough, but no buffer large enough was free.
+} spi_buffer_pool_stats_t;
+
+/** This interface allows clients of an asynchronous SPI master to borrow
+ *  transfer buffers from a buffer pool task and return them.
+ */
+#ifndef __DOXYGEN__
+typedef interface spi_buffer_pool_if {
+#endif
+
+  /**
+   * @defgroup spi_buffer_pool_if
+   * Methods for the SPI buffer pool interface.
+   * @{
+   */
+
+  /** Borrow a buffer of at least nbytes bytes. The buffer is taken from the
+   *  smallest size class which has one free.
+   *
+   *  \param buf     A movable pointer, which must be null, that is set to
+   *                 the buffer. It is left null if no buffer is free.
+   *  \param nbytes  The number of bytes needed.
+   *
+   *  \returns       The size of the buffer in bytes, or 0 if no buffer
+   *                 was free.
+   */
+  size_t alloc_8(REFERENCE_PARAM(uint8_t_movable_ptr_t, buf), size_t nbytes);
+
+  /** Return a buffer borrowed with alloc_8().
+   *
+   *  \param buf     A movable pointer to the buffer, moved to the pool.
+   *  \param nbytes  The size returned by alloc_8() for the buffer.
+   */
+  void free_8(uint8_t_movable_ptr_t buf, size_t nbytes);
+
+  /** Borrow a buffer of at least nwords words, as alloc_8().
+   *
+   *  \param buf     A movable pointer, which must be null, that is set to
+   *                 the buffer. It is left null if no buffer is free.
+   *  \param nwords  The number of words needed.
+   *
+   *  \returns       The size of the buffer in words, or 0 if no buffer
+   *                 was free.
+   */
+  size_t alloc_32(REFERENCE_PARAM(uint32_t_movable_ptr_t, buf), size_t nwords);
+
+  /** Return a buffer borrowed with alloc_32().
+   *
+   *  \param buf     A movable pointer to the buffer, moved to the pool.
+   *  \param nwords  The size returned by alloc_32() for the buffer.
+   */
+  void free_32(uint32_t_movable_ptr_t buf, size_t nwords);
+
+  /** Get the counts kept for a size class.
+   *
+   *  \param size_class  The index of the class in the classes array given
+   *                     to spi_buffer_pool().
+   *
+   *  \returns           The counts since the task started.
+   */
+  spi_buffer_pool_stats_t get_stats(unsigned size_class);
+
+#ifndef __DOXYGEN__
+} spi_buffer_pool_if;
+#endif
+
+/**@}*/ // end: spi_buffer_pool_if
+
+/** Task that lends transfer buffers for the asynchronous SPI master from
+ *  a fixed pool shared by its clients.
+ *
+ *  Clients borrow a buffer before a transfer, hand it to
+ *  init_transfer_array_8() or init_transfer_array_32() and return it to
+ *  the pool after retrieving it from the master, so the memory used for
+ *  transfer buffers depends on how many transfers are in flight rather than
+ *  on the number of clients. A movable pointer must be null when it goes
+ *  out of scope if it was declared null, so clients must return every
+ *  buffer they borrow before the function holding it returns.
+ *
+ *  The pool is split into size classes, which should be given smallest
+ *  first. The buffers need not all be the same size.
+ *
+ *  \param i            An array of interface connections to the clients of the task.
+ *  \param num_clients  The number of clients connected to the task.
+ *  \param classes      The size classes of the pool.
+ *  \param num_classes  The number of size classes.
+ *  \param pool_words   The memory for the buffers in words. This must be
+ *                      the sum of SPI_BUFFER_POOL_WORDS() for the classes.
+ */
+void spi_buffer_pool(SERVER_INTERFACE(spi_buffer_pool_if, i[num_clients]),
+                     static_const_size_t num_clients,
+                     const spi_buffer_pool_class_t classes[num_classes],
+                     static_const_size_t num_classes,
+                     static_const_size_t pool_words);
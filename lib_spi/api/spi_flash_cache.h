@@ -0,0 +1,133 @@
+// Copyright 2025 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+
+/** The number of lines after a missed line that spi_flash_cache() and
+ *  spi_flash_cache_async() read in the same transaction when reads are
+ *  sequential. Lines which are already cached end the read-ahead early.
+ *  Set to 0 to disable read-ahead.
+ */
+#ifndef SPI_FLASH_CACHE_READ_AHEAD_LINES
+#define SPI_FLASH_CACHE_READ_AHEAD_LINES 1
+#endif
+
+/** The largest number of opcode, address and dummy bytes a cache read
+ *  command may have. A flash cache task traps at startup if its
+ *  configuration gives a longer command.
+ */
+#define SPI_FLASH_CACHE_MAX_HEADER_BYTES 8
+
+/** This type describes how a flash cache task reads from its device. The
+ *  read command is the opcode, the address MSB first in address_bytes bytes
+ *  and then dummy_bytes bytes of zero, after which the device returns data
+ *  from that address for as long as the transaction continues. For example
+ *  0x03 with three address bytes for most SPI NOR flash, 0x0B with one
+ *  dummy byte for fast read, or 0x03 with two address bytes for EEPROM.
+ */
+typedef struct spi_flash_cache_config_t {
+  unsigned device_index;     ///< The device index on the SPI master.
+  unsigned speed_in_khz;     ///< The SPI clock speed for reads.
+  spi_mode_t mode;           ///< The SPI mode of the device.
+  unsigned ss_deassert_time; ///< Passed to end_transaction() after each read.
+  uint8_t read_opcode;       ///< The read command opcode.
+  uint8_t address_bytes;     ///< The number of address bytes, 1 to 4.
+  uint8_t dummy_bytes;       ///< The number of dummy bytes after the address, at most SPI_FLASH_CACHE_MAX_HEADER_BYTES - 1 - address_bytes.
+} spi_flash_cache_config_t;
+
+/** This type holds the counts kept by a flash cache task since it started. */
+typedef struct spi_flash_cache_stats_t {
+  uint32_t hits;              ///< Line accesses served from the cache.
+  uint32_t misses;            ///< Line accesses which had to read the device.
+  uint32_t read_ahead_lines;  ///< Lines read ahead of being accessed.
+  uint32_t transactions;      ///< SPI transactions made to fill lines.
+} spi_flash_cache_stats_t;
+
+/** This interface allows clients to read a SPI flash or EEPROM through
+ *  a flash cache task.
+ */
+#ifndef __DOXYGEN__
+typedef interface spi_flash_cache_if {
+#endif
+
+  /**
+   * @defgroup spi_flash_cache_if
+   * Methods for the SPI flash cache interface.
+   * @{
+   */
+
+  /** Read from the device, through the cache.
+   *
+   *  \param address    The device address to read from.
+   *  \param data       Array to fill with the data read.
+   *  \param num_bytes  The number of bytes to read.
+   */
+  void read(unsigned address, uint8_t data[], unsigned num_bytes);
+
+  /** Discard any cached data for a range of addresses. This must be called
+   *  after the range is written or erased through the SPI master.
+   *
+   *  \param address    The first address which has changed.
+   *  \param num_bytes  The number of bytes which have changed.
+   */
+  void invalidate(unsigned address, unsigned num_bytes);
+
+  /** Discard all cached data, for example after a chip erase. */
+  void invalidate_all(void);
+
+  /** Get the hit and miss counts of the cache.
+   *
+   *  \returns The counts since the task started.
+   */
+  spi_flash_cache_stats_t get_stats(void);
+
+#ifndef __DOXYGEN__
+} spi_flash_cache_if;
+#endif
+
+/**@}*/ // end: spi_flash_cache_if
+
+/** Task that caches reads from a SPI flash or EEPROM device through a
+ *  synchronous SPI master.
+ *
+ *  Data is held in num_lines lines of line_size bytes, aligned to multiples
+ *  of line_size in the device, and the least recently used line is replaced
+ *  on a miss. When a miss follows an access to the line before it, up to
+ *  SPI_FLASH_CACHE_READ_AHEAD_LINES further lines are read in the same
+ *  transaction, so sequential reads pay the command and chip select
+ *  overhead once per several lines.
+ *
+ *  The cache cannot see writes made to the device by other clients of the
+ *  SPI master, so the writer must call invalidate() afterwards.
+ *
+ *  \param i            An array of interface connections to the clients of the task.
+ *  \param num_clients  The number of clients connected to the task.
+ *  \param spi          The SPI master to read the device through.
+ *  \param config       How to read the device.
+ *  \param line_size    The size of each cache line in bytes.
+ *  \param num_lines    The number of cache lines.
+ */
+[[distributable]]
+void spi_flash_cache(SERVER_INTERFACE(spi_flash_cache_if, i[num_clients]),
+                     static_const_size_t num_clients,
+                     CLIENT_INTERFACE(spi_master_if, spi),
+                     spi_flash_cache_config_t config,
+                     static_const_size_t line_size,
+                     static_const_size_t num_lines);
+
+/** As spi_flash_cache(), but reading the device through an asynchronous
+ *  SPI master. The task waits for each fill to complete before answering
+ *  the read which caused it.
+ *
+ *  \param i            An array of interface connections to the clients of the task.
+ *  \param num_clients  The number of clients connected to the task.
+ *  \param spi          The asynchronous SPI master to read the device through.
+ *  \param config       How to read the device.
+ *  \param line_size    The size of each cache line in bytes.
+ *  \param num_lines    The number of cache lines.
+ */
+void spi_flash_cache_async(SERVER_INTERFACE(spi_flash_cache_if, i[num_clients]),
+                           static_const_size_t num_clients,
+                           CLIENT_INTERFACE(spi_master_async_if, spi),
+                           spi_flash_cache_config_t config,
+                           static_const_size_t line_size,
+                           static_const_size_t num_lines);
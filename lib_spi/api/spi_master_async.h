@@ -158,6 +158,14 @@ typedef interface spi_master_async_if  {
    */
   void set_ss_clock_timing(unsigned device_index, spi_master_ss_clock_timing_t ss_clock_timing);
 
+  /** Returns the worst lateness of the slave select deassert and SPI
+   *  clock edges against their schedule since the task started, as
+   *  spi_master_lateness().
+   *
+   *  \returns  The worst lateness of each kind of edge.
+   */
+  spi_master_lateness_t get_lateness(void);
+
   /** Shut down the SPI master interface server. Must be done after all transactions are complete
    *  to avoid leaving moveable pointers in the wrong place.
    */
@@ -2,6 +2,30 @@
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 
+/** Set to a buffer size in bytes to have spi_master() combine runs of
+ *  write-only transfers within a transaction. Such transfers are held back
+ *  and sent as one contiguous burst when a transfer which reads data is
+ *  made, when end_transaction() is called or when the buffer is full, so
+ *  the bus does not pause between them. transfer_array() is write-only
+ *  when data_in is null, and all transfers are write-only when the master
+ *  has no MISO port. Defaults to 0, which disables combining. Only the fast
+ *  SPI master which uses a clock block combines transfers.
+ */
+#ifndef SPI_MASTER_WRITE_COMBINE_BYTES
+#define SPI_MASTER_WRITE_COMBINE_BYTES 0
+#endif
+
+/** Set to 1 to have spi_master() input MISO data in a thread of its own,
+ *  leaving its main thread to output only SCLK and MOSI. This raises the
+ *  highest SCLK rate at which transfers which read data can be sustained,
+ *  at the cost of a second thread. spi_master() is then not distributable,
+ *  so uses two threads in all. Only the fast SPI master which uses a clock
+ *  block uses the second thread. Defaults to 0.
+ */
+#ifndef SPI_MASTER_RX_DRAIN_THREAD
+#define SPI_MASTER_RX_DRAIN_THREAD 0
+#endif
+
 /** This interface allows clients to interact with SPI master task. */
 #ifndef __DOXYGEN__
 typedef interface spi_master_if {
@@ -119,6 +143,28 @@ typedef interface spi_master_if {
    */
   void set_ss_clock_timing(unsigned device_index, spi_master_ss_clock_timing_t ss_clock_timing);
 
+  /** Returns the number of transfers with a device which fell behind the
+   *  port schedule, and so may have corrupted data, since its speed, mode
+   *  or timing settings last changed. Only the fast SPI master which uses
+   *  a clock block checks for this. Build with SPI_MASTER_CLOCK_BACKOFF_RETRY
+   *  set to have the SPI clock slowed automatically on these errors.
+   *
+   *  \param device_index  The index of the device.
+   *
+   *  \returns             The number of late transfers.
+   */
+  unsigned get_timing_error_count(unsigned device_index);
+
+  /** Returns the worst lateness of the slave select deassert and SPI
+   *  clock edges against their schedule since the task started, as
+   *  spi_master_lateness(). This shows how much other threads on the tile
+   *  delay the bus, with and without SPI_MASTER_REALTIME. Only the fast
+   *  SPI master which uses a clock block measures this.
+   *
+   *  \returns  The worst lateness of each kind of edge.
+   */
+  spi_master_lateness_t get_lateness(void);
+
   /** Shut down the SPI master interface server.
    */
   void shutdown(void);
@@ -155,7 +201,9 @@ typedef interface spi_master_if {
     \param clk           A clock for the component to use. May be set
                          to null if low speed operation is acceptable.
 */
+#if !SPI_MASTER_RX_DRAIN_THREAD
 [[distributable]]
+#endif
 void spi_master(
         SERVER_INTERFACE(spi_master_if, i[num_clients]),
         static_const_size_t num_clients,
@@ -165,3 +213,37 @@ void spi_master(
         out_port p_ss,
         static_const_size_t num_slaves,
         NULLABLE_RESOURCE(clock, clk));
+
+/** Task that implements the SPI protocol in master mode on several
+    independent buses from a single thread.
+
+    Client ``x`` of the task uses bus ``x``, so there must be one client
+    per bus. Each bus has its own clock block, so buses may run at
+    different speeds and in different modes, and transactions on
+    different buses may be open at the same time. Transfers on the buses
+    are interleaved, one interface call at a time.
+
+    The interface functions behave as they do for spi_master(), with the
+    device_index parameter selecting a slave on the bus of the client.
+    The task returns once every client has called i.shutdown().
+
+    \param i             An array of interface connections, one per bus.
+    \param num_buses     The number of buses, and of clients.
+    \param sclk          The SPI clock port of each bus.
+    \param mosi          The SPI MOSI (master out, slave in) port of each bus.
+    \param miso          The SPI MISO (master in, slave out) port of each bus.
+    \param p_ss          The slave select port of each bus. Please specify
+                         mapping of bits to slaves using i.set_ss_port_bit().
+    \param num_slaves    The number of slave devices on each bus.
+    \param clk           A clock block for each bus.
+*/
+[[distributable]]
+void spi_master_multi_bus(
+        SERVER_INTERFACE(spi_master_if, i[num_buses]),
+        static_const_size_t num_buses,
+        out_buffered_port_32_t sclk[num_buses],
+        out_buffered_port_32_t mosi[num_buses],
+        in_buffered_port_32_t miso[num_buses],
+        out_port p_ss[num_buses],
+        static_const_size_t num_slaves,
+        clock clk[num_buses]);
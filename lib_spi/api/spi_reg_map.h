@@ -0,0 +1,106 @@
+// Copyright 2025 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+
+/** This type describes how a register map task addresses its device. Each
+ *  access is a transaction which starts with the register address, MSB
+ *  first in address_bytes bytes, with read_flag or write_flag ORed into the
+ *  first byte. The device must then auto-increment the address for each
+ *  further byte of the transaction. For example a read_flag of 0x80 and a
+ *  write_flag of 0x00 with one address byte suits many sensors and codecs.
+ */
+typedef struct spi_reg_map_config_t {
+  unsigned device_index;     ///< The device index on the SPI master.
+  unsigned speed_in_khz;     ///< The SPI clock speed.
+  spi_mode_t mode;           ///< The SPI mode of the device.
+  unsigned ss_deassert_time; ///< Passed to end_transaction() after each access.
+  uint8_t address_bytes;     ///< The number of address bytes, 1 or 2.
+  uint8_t read_flag;         ///< Bits set in the first address byte of a read.
+  uint8_t write_flag;        ///< Bits set in the first address byte of a write.
+} spi_reg_map_config_t;
+
+/** This interface allows clients to access the registers of a SPI device
+ *  through a register map task.
+ */
+#ifndef __DOXYGEN__
+typedef interface spi_reg_map_if {
+#endif
+
+  /**
+   * @defgroup spi_reg_map_if
+   * Methods for the SPI register map interface.
+   * @{
+   */
+
+  /** Read a register. A cacheable register is only read from the device the
+   *  first time; after that its shadow copy is returned.
+   *
+   *  \param reg  The register address.
+   *
+   *  \returns    The register value.
+   */
+  uint8_t read(unsigned reg);
+
+  /** Write a register. A cacheable register is only written to its shadow
+   *  copy and marked dirty until flush() is called. A volatile register is
+   *  written to the device straight away.
+   *
+   *  \param reg    The register address.
+   *  \param value  The value to write.
+   */
+  void write(unsigned reg, uint8_t value);
+
+  /** Change some bits of a register, as write(reg, (read(reg) & ~mask) | (value & mask)).
+   *
+   *  \param reg    The register address.
+   *  \param mask   The bits to change.
+   *  \param value  The new value of the bits to change.
+   */
+  void update_bits(unsigned reg, uint8_t mask, uint8_t value);
+
+  /** Write all dirty registers to the device. Each run of consecutive dirty
+   *  registers is written in a single transaction.
+   */
+  void flush(void);
+
+  /** Mark a range of registers as volatile or cacheable. Volatile registers
+   *  may be changed by the device, so they are never cached. All registers
+   *  are cacheable to begin with.
+   *
+   *  \param reg          The first register address.
+   *  \param num_regs     The number of registers.
+   *  \param is_volatile  Non-zero to make the registers volatile, zero to
+   *                      make them cacheable.
+   */
+  void set_volatile(unsigned reg, unsigned num_regs, int is_volatile);
+
+  /** Discard all shadow copies, including dirty ones, for example after the
+   *  device has been reset.
+   */
+  void invalidate_all(void);
+
+#ifndef __DOXYGEN__
+} spi_reg_map_if;
+#endif
+
+/**@}*/ // end: spi_reg_map_if
+
+/** Task that keeps a shadow copy of the registers of a SPI device, so that
+ *  reads of registers which only the application changes, and the read half
+ *  of read-modify-write sequences, do not need a bus transaction.
+ *
+ *  Registers at or above num_regs are passed straight through to the
+ *  device as if volatile.
+ *
+ *  \param i            An array of interface connections to the clients of the task.
+ *  \param num_clients  The number of clients connected to the task.
+ *  \param spi          The SPI master to access the device through.
+ *  \param config       How to address the device registers.
+ *  \param num_regs     The number of registers to shadow, from address 0.
+ */
+[[distributable]]
+void spi_reg_map(SERVER_INTERFACE(spi_reg_map_if, i[num_clients]),
+                 static_const_size_t num_clients,
+                 CLIENT_INTERFACE(spi_master_if, spi),
+                 spi_reg_map_config_t config,
+                 static_const_size_t num_regs);
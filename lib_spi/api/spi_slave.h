@@ -2,6 +2,69 @@
 // This Software is subject to the terms of the XMOS Public Licence: Version 1.
 
 
+/** Set to 1 to have spi_slave() fetch the MISO response words for a
+ *  transaction before slave select is asserted. Both master_requires_data()
+ *  calls for the next transaction are then made straight after
+ *  master_ends_transaction() (and once at startup), so that on assertion the
+ *  slave only has to output the already prepared data. This reduces the minimum
+ *  time the master must leave between asserting slave select and the first
+ *  clock edge, at the cost of the application supplying response data one
+ *  transaction early.
+ */
+#ifndef SPI_SLAVE_PREARM_MISO
+#define SPI_SLAVE_PREARM_MISO 0
+#endif
+
+/** Set to the width in bits (1 to 32) of a CRC for spi_slave() to accumulate
+ *  over the words sent and received in each transaction, or 0 (the default)
+ *  to disable it. The CRC is calculated MSB first in wire order and covers
+ *  whole port transfers only: for widths other than 8, 16 and 32 bits
+ *  that is whole 32-bit words. When enabled, the application must also handle
+ *  the master_transaction_crc() callback.
+ */
+#ifndef SPI_SLAVE_CRC_WIDTH
+#define SPI_SLAVE_CRC_WIDTH 0
+#endif
+
+/** The generator polynomial used when SPI_SLAVE_CRC_WIDTH is non-zero, in normal
+ *  (non-reflected) form without the implicit top bit. For example 0x1021 for CRC16.
+ */
+#ifndef SPI_SLAVE_CRC_POLY
+#define SPI_SLAVE_CRC_POLY 0
+#endif
+
+/** The initial CRC register value used when SPI_SLAVE_CRC_WIDTH is non-zero.
+ */
+#ifndef SPI_SLAVE_CRC_INIT
+#define SPI_SLAVE_CRC_INIT 0
+#endif
+
+
+/** Set to 1 to run spi_slave() in continuous streaming mode. Transactions are
+ *  then delimited by a count of transfer words rather than by slave select, and
+ *  master_ends_transaction() is called at the end of each frame. Slave select may
+ *  be held asserted across any number of frames. If it is deasserted on a frame
+ *  boundary the ports are left set up, so MISO keeps driving and back-to-back
+ *  frames need no re-arming. Deasserting it part way through a frame discards
+ *  the rest of that frame and resynchronises as at the end of a normal
+ *  transaction. As MISO is not made Hi-Z between frames, the slave must not
+ *  share MISO with other devices in this mode.
+ */
+#ifndef SPI_SLAVE_STREAM
+#define SPI_SLAVE_STREAM 0
+#endif
+
+/** The number of transfer words in each frame when SPI_SLAVE_STREAM is enabled.
+ *  If 0 (the default) frames are length-prefixed: the first word of each frame
+ *  holds the number of words which follow it. Streaming requires a
+ *  transfer width of 8, 16 or 32 bits, and spi_slave() traps on start up
+ *  if it is given any other width.
+ */
+#ifndef SPI_SLAVE_STREAM_FRAME_WORDS
+#define SPI_SLAVE_STREAM_FRAME_WORDS 0
+#endif
+
+
 /** This interface allows clients to interact with SPI slave tasks by
  *  completing callbacks that show how to handle data.
  */
@@ -17,7 +80,8 @@ typedef interface spi_slave_callback_if {
 
 
   /** This callback will get called when the master de-asserts on the slave
-   *  select line to end a transaction.
+   *  select line to end a transaction, or at the end of each frame if
+   *  SPI_SLAVE_STREAM is enabled.
    */
   void master_ends_transaction(void);
 
@@ -25,25 +89,35 @@ typedef interface spi_slave_callback_if {
    *  or when more data is required during a transaction.
    *  The application must supply the data to transmit to the master. 
    *  Data is transmitted with the least significant bit
-   *  first.  If the master completes the transaction before 8/32 bits (
-   *  depending on SPI_TRANSFER_SIZE_8 or SPI_TRANSFER_SIZE_32) are
-   *  transferred and the remaining bits are discarded.
+   *  first.  If the master completes the transaction before the whole
+   *  word (of the transfer type's width) is transferred the remaining
+   *  bits are discarded.
    *
-   *  \returns the 8-bit or 32-bit value to transmit.
+   *  \returns the value to transmit in the low bits of the word.
    */
   uint32_t master_requires_data(void);
 
   /** This callback will get called after a transfer. It will occur after
-   *  every 8 bits transferred if the slave component is set to
-   *  ``SPI_TRANSFER_SIZE_8``. If the component is set to
-   *  ``SPI_TRANSFER_SIZE_32`` then it will occur if the master ends the
-   *  transaction before 32 bits are transferred.
+   *  every word of the transfer type's width, for example every 8 bits
+   *  if the slave component is set to ``SPI_TRANSFER_SIZE_8``. It will also
+   *  occur with fewer valid bits if the master ends the transaction part way
+   *  through a word.
    *
    *  \param datum the data received from the master.
    *  \param valid_bits the number of valid bits of data received from the master.
    */
   void master_supplied_data(uint32_t datum, uint32_t valid_bits);
 
+#if SPI_SLAVE_CRC_WIDTH
+  /** This callback will get called when the master de-asserts slave select,
+   *  just before master_ends_transaction(), if SPI_SLAVE_CRC_WIDTH is non-zero.
+   *
+   *  \param tx_crc the CRC of the words transmitted to the master.
+   *  \param rx_crc the CRC of the words received from the master.
+   */
+  void master_transaction_crc(uint32_t tx_crc, uint32_t rx_crc);
+#endif
+
   /** Request shut down the SPI slave interface client.
    */
   [[notification]]
@@ -63,10 +137,16 @@ typedef interface spi_slave_callback_if {
 
 
 /** This type specifies the transfer size from the SPI slave component
-    to the application */
+    to the application. The value of each member is its width in bits, and
+    any other width from 1 to 32 may be used by casting it to this type.
+    8, 16 and 32-bit words are transferred natively by the port; other
+    widths are repacked from 32-bit port transfers, which costs a little
+    more time per word. */
 typedef enum spi_transfer_type_t {
-  SPI_TRANSFER_SIZE_8, ///< Transfers should be 8-bit.
-  SPI_TRANSFER_SIZE_32 ///< Transfers should be 32-bit.
+  SPI_TRANSFER_SIZE_8 = 8,   ///< Transfers should be 8-bit.
+  SPI_TRANSFER_SIZE_16 = 16, ///< Transfers should be 16-bit.
+  SPI_TRANSFER_SIZE_24 = 24, ///< Transfers should be 24-bit.
+  SPI_TRANSFER_SIZE_32 = 32  ///< Transfers should be 32-bit.
 } spi_transfer_type_t;
 
 /** SPI slave component.
@@ -82,8 +162,11 @@ typedef enum spi_transfer_type_t {
  *  \param p_ss          The SPI SS (slave select) port.
  *  \param clk           Clock to be used by the component.
  *  \param mode          The SPI mode of the bus.
- *  \param transfer_type The type of transfer the slave will perform: either
- *                       ``SPI_TRANSFER_SIZE_8`` or ``SPI_TRANSFER_SIZE_32``.
+ *  \param transfer_type The width of each word the slave transfers:
+ *                       ``SPI_TRANSFER_SIZE_8``, ``SPI_TRANSFER_SIZE_16``,
+ *                       ``SPI_TRANSFER_SIZE_24``, ``SPI_TRANSFER_SIZE_32``, or
+ *                       any other width from 1 to 32 bits cast to
+ *                       spi_transfer_type_t.
  */
  [[combinable]]
   void spi_slave(CLIENT_INTERFACE(spi_slave_callback_if, spi_i),
@@ -94,3 +177,107 @@ typedef enum spi_transfer_type_t {
                  clock clk,
                  static_const_spi_mode_t mode,
                  static_const_spi_transfer_type_t transfer_type);
+
+
+/** This type describes the header at the start of each transaction to
+ *  spi_slave_register_file(). The header is address_bytes bytes, MSB first.
+ *  If any of the read_flag bits are set in it the transaction is a read,
+ *  otherwise it is a write, and the rest of the header is the offset into
+ *  the register file of the first byte to read or write. For example an
+ *  address_bytes of 1 and a read_flag of 0x80 gives 128 registers with the
+ *  top bit of the address selecting a read.
+ */
+typedef struct spi_slave_register_file_format_t {
+  uint8_t address_bytes;  ///< The number of header bytes, 1 to 4.
+  uint32_t read_flag;     ///< The header bits which mark a read.
+} spi_slave_register_file_format_t;
+
+/** This type summarises a transaction handled by spi_slave_register_file().
+ *  The address auto-increments for each byte, wrapping from the end of the
+ *  register file to its start, so the dirty range may also wrap.
+ */
+typedef struct spi_slave_register_file_summary_t {
+  int is_read;            ///< Non-zero if the header marked a read.
+  uint32_t address;       ///< The offset given in the header.
+  uint32_t num_bytes;     ///< The number of whole bytes after the header.
+  uint32_t dirty_address; ///< The offset of the first byte written.
+  uint32_t dirty_bytes;   ///< The number of bytes written, 0 for a read.
+} spi_slave_register_file_summary_t;
+
+/** This interface allows clients to be told about the transactions
+ *  handled by a SPI register file slave task.
+ */
+#ifndef __DOXYGEN__
+typedef interface spi_slave_register_file_if {
+#endif
+
+  /**
+  * @defgroup spi_slave_register_file_if
+  * Methods for SPI register file slave interface.
+  * @{
+  */
+
+  /** This callback will get called when the master de-asserts the slave
+   *  select line to end a transaction, after the data has been read from or
+   *  written to the register file.
+   *
+   *  \param summary what the transaction did.
+   */
+  void master_ends_transaction(spi_slave_register_file_summary_t summary);
+
+  /** Request shut down the SPI slave interface client.
+   */
+  [[notification]]
+  slave void request_shutdown(void);
+
+  /** Acknowledgment that the SPI slave task has been shutdown.
+   */
+  [[clears_notification]]
+  [[guarded]]
+  void shutdown_complete(void);
+
+#ifndef __DOXYGEN__
+} spi_slave_register_file_if;
+#endif
+
+/**@}*/ // end: spi_slave_register_file_if
+
+/** SPI register file slave component.
+ *
+ *  This function implements an SPI slave bus which serves reads and writes
+ *  of a register file in memory owned by the application, without a
+ *  callback for each byte. Each transaction starts with a header giving
+ *  the direction and the offset in the register file. For a write, each
+ *  following byte is stored at the next offset. For a read, the byte at the
+ *  offset is returned in the byte straight after the header, so the master
+ *  needs no dummy bytes, and the following bytes come from the following
+ *  offsets. Transfers are 8 bits wide.
+ *
+ *  The application may read and write the register file at any time. A
+ *  byte is only read from it just before it is sent to the master.
+ *
+ *  \param spi_i         The interface to connect to the user of the component.
+ *                       The component acts as the client and will make callbacks to
+ *                       the application.
+ *  \param p_sclk        The SPI clock port.
+ *  \param p_mosi        The SPI MOSI (master out, slave in) port.
+ *  \param p_miso        The SPI MISO (master in, slave out) port.
+ *  \param p_ss          The SPI SS (slave select) port.
+ *  \param clk           Clock to be used by the component.
+ *  \param mode          The SPI mode of the bus.
+ *  \param regs          The register file.
+ *  \param num_regs      The size of the register file in bytes, which must
+ *                       not be 0.
+ *  \param format        The format of the transaction header.
+ */
+ [[combinable]]
+  void spi_slave_register_file(CLIENT_INTERFACE(spi_slave_register_file_if, spi_i),
+                               in_port p_sclk,
+                               in_buffered_port_32_t p_mosi,
+                               NULLABLE_RESOURCE(out_buffered_port_32_t, p_miso),
+                               in_port p_ss,
+                               clock clk,
+                               static_const_spi_mode_t mode,
+                               uint8_t_unsafe_ptr_t regs,
+                               unsigned num_regs,
+                               spi_slave_register_file_format_t format);
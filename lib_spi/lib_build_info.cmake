@@ -1,6 +1,7 @@
 set(LIB_NAME lib_spi)
-set(LIB_VERSION 4.0.0)
+set(LIB_VERSION 5.0.0)
 set(LIB_INCLUDES api)
 set(LIB_DEPENDENT_MODULES "")
 set(LIB_COMPILER_FLAGS_spi_master_async.xc -Wno-reinterpret-alignment)
+set(LIB_COMPILER_FLAGS_spi_buffer_pool.xc -Wno-reinterpret-alignment)
 XMOS_REGISTER_MODULE()
@@ -20,6 +20,31 @@
 /* Default delay from clock to SS, SS de-assert to SS assert and SS to clock */
 #define SPI_MASTER_DEFAULT_SS_CLOCK_DELAY_TICKS  20 // 200 nanoseconds
 
+/**
+ * The number of requests each producer may have outstanding in a
+ * spi_master_queue_t. Must be a power of two.
+ */
+#ifndef SPI_MASTER_QUEUE_DEPTH
+#define SPI_MASTER_QUEUE_DEPTH 4
+#endif
+
+/**
+ * The default for spi_master_set_clock_backoff() set by
+ * spi_master_device_init(). 0 disables the back-off.
+ */
+#ifndef SPI_MASTER_CLOCK_BACKOFF_RETRY
+#define SPI_MASTER_CLOCK_BACKOFF_RETRY 0
+#endif
+
+/**
+ * The default for spi_master_set_realtime() set by spi_master_init(). This
+ * also applies to spi_master(), with or without a clock block, and
+ * spi_master_async().
+ */
+#ifndef SPI_MASTER_REALTIME
+#define SPI_MASTER_REALTIME 0
+#endif
+
 
 #include <stdlib.h> /* for size_t */
 #include <stdint.h>
@@ -32,6 +57,7 @@
 #include <xcore/clock.h>
 #include <xcore/thread.h>
 #include <xcore/hwtimer.h>
+#include <xcore/chanend.h>
 // Copy from xs1.h because this doesn't get included for non __XC__ files
 /**Tests whether a time input from a timer is considered to come after
  * another time input from a timer. The comparison is the same as that
@@ -45,6 +71,14 @@
 /* When using XC, ensure we don't define as resource types to avoid issues with automatics */
 #define xclock_t unsigned 
 #define port_t unsigned
+#define chanend_t unsigned
+#endif
+
+/* XC has no volatile qualifier. Members declared with this are only accessed from C. */
+#ifdef __XC__
+#define SPI_VOLATILE
+#else
+#define SPI_VOLATILE volatile
 #endif
 
 /* The SETC constant for pad delay is missing from xs2a_user.h */
@@ -64,6 +98,18 @@ inline void spi_io_port_outpw(
 {
     asm volatile("outpw res[%0], %1, %2" : : "r" (__p), "r" (__w), "r" (__bpw));
 }
+
+/* Wrapper for the crc8 instruction. Returns the data shifted right by 8 bits. */
+__attribute__((always_inline))
+static inline uint32_t spi_crc8(
+        uint32_t *crc,
+        uint32_t data,
+        uint32_t poly)
+{
+    uint32_t shifted;
+    asm volatile("crc8 %0, %1, %2, %3" : "=r" (shifted), "+r" (*crc) : "r" (data), "r" (poly));
+    return shifted;
+}
 #endif
 
 /**
@@ -93,6 +139,39 @@ typedef enum {
     spi_master_source_clock_xcore    /**< SCLK is derived from the core clock */
 } spi_master_source_clock_t;
 
+/**
+ * Struct to hold a CRC accumulator for the transmitted and received data of
+ * a transaction. See spi_crc_init() and spi_master_transfer_crc().
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct {
+    uint32_t poly;  /* Reflected polynomial, as used by the crc8/crc32 instructions */
+    uint32_t width;
+    uint32_t tx;
+    uint32_t rx;
+} spi_crc_t;
+
+/**
+ * Struct to hold the state of a split-phase transfer started by
+ * spi_master_transfer_start().
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct {
+    uint8_t *data_out;
+    uint8_t *data_in;
+    uint32_t word_count;      /* Number of port words (16 SPI bits each) in the transfer */
+    uint32_t remainder;       /* 1 if the last port word only carries one byte */
+    uint32_t next_out;        /* Index of the next port word to output */
+    uint32_t next_in;         /* Index of the next port word to input */
+    uint32_t start_time;      /* Reference time at which the clock block was started */
+    uint32_t word_ticks_q16;  /* Reference ticks per port word, Q16.16 */
+    int do_output;
+    int do_input;
+    int active;
+} spi_master_transfer_state_t;
+
 /**
  * Struct to hold a SPI master context.
  *
@@ -100,14 +179,32 @@ typedef enum {
  */
 typedef struct {
     xclock_t clock_block;
+    xclock_t data_clock_block;  /* Clocks MOSI and MISO from SCLK, or 0 if unused */
     port_t cs_port;
     port_t sclk_port;
     port_t mosi_port;
     port_t miso_port;
     uint32_t current_device;
+    int current_device_stale;   /* The current device was re-initialized, so its settings must be applied again */
     int delay_before_transfer;
+    chanend_t rx_drain;         /* Streaming channel end to a spi_master_rx_drain_run() thread, or 0 */
+    int realtime;               /* Raise the thread mode for the duration of each transaction */
+    uint32_t saved_thread_mode; /* Real-time mode bits which were already set when the transaction began */
+    uint32_t cs_due_time;       /* Reference time the last CS output scheduled by spi_master_schedule_cs() is due */
+    uint32_t cs_late_max;       /* Worst CS deassert lateness, in reference clock ticks */
+    uint32_t sclk_late_max;     /* Worst SCLK lateness, in SCLK port clock ticks */
+    spi_master_transfer_state_t xfer;
 } spi_master_t;
 
+/**
+ * The worst lateness of the edges output by a SPI master against the
+ * times they were scheduled for, see spi_master_lateness().
+ */
+typedef struct {
+    uint32_t cs_ticks;    /**< CS deassert after the end of the clock to CS delay, in reference clock ticks. */
+    uint32_t sclk_ticks;  /**< The last SCLK or MOSI edges of a transfer after their scheduled time, in half SCLK periods. */
+} spi_master_lateness_t;
+
 /**
  * Struct type representing a SPI device connected to a SPI master
  * interface.
@@ -124,18 +221,23 @@ typedef struct {
     uint32_t cs_assert_val;
     uint32_t clock_delay;
     uint32_t clock_bits;
+    uint32_t sclk_invert;
     uint32_t cs_to_clk_delay_ticks;
     uint32_t clk_to_cs_delay_ticks;
     uint32_t cs_to_cs_delay_ticks;
+    uint32_t nominal_clock_divisor;  /* The divisor given to spi_master_device_init() */
+    uint32_t timing_error_count;
+    uint32_t clock_backoff_retry;
+    uint32_t clock_backoff_count;
 } spi_master_device_t;
 
 /**
  * Initializes a SPI master I/O interface.
  *
- * Note: To guarantee timing in all situations, the SPI I/O interface
- * implicitly sets the fast mode and high priority status register bits
- * for the duration of SPI operations.  This may reduce the MIPS of other
- * threads based on overall system setup.
+ * Note: The thread's fast mode and high priority status register bits
+ * are only set for the duration of transactions in real-time mode, see
+ * spi_master_set_realtime(), which is off by default. Without it, other
+ * threads on the tile may delay the SPI edges.
  *
  * \param spi         The spi_master_t context to initialize.
  * \param clock_block The clock block to use for the SPI master interface.
@@ -152,6 +254,40 @@ void spi_master_init(
         port_t mosi_port,
         port_t miso_port);
 
+/**
+ * Initializes a SPI master I/O interface with its MOSI and MISO ports
+ * clocked by the SCLK pin, through a second clock block. MOSI and MISO
+ * then carry one SPI bit per port bit rather than two, so each port
+ * operation moves 32 bits of data and the per-bit instruction cost of a
+ * transfer is roughly halved. This allows higher SCLK rates to be
+ * sustained for full-duplex transfers.
+ *
+ * The CPOL and CPHA of each device are implemented by inverting the SCLK
+ * port and by the level it idles at. With CPHA 0, the first bit of each
+ * transfer is driven onto MOSI before SCLK starts.
+ *
+ * On an interface initialized with this function, spi_master_transfer_crc()
+ * calculates the CRCs once the transfer has completed, and
+ * spi_master_transfer_start() completes the whole transfer before it
+ * returns.
+ *
+ * \param spi              The spi_master_t context to initialize.
+ * \param clock_block      The clock block to use to generate SCLK.
+ * \param data_clock_block The clock block to use to clock MOSI and MISO from SCLK.
+ * \param cs_port          The SPI interface's chip select port. This may be a multi-bit port.
+ * \param sclk_port        The SPI interface's SCLK port. Must be a 1-bit port.
+ * \param mosi_port        The SPI interface's MOSI port. Must be a 1-bit port.
+ * \param miso_port        The SPI interface's MISO port. Must be a 1-bit port.
+ */
+void spi_master_init_sclk_clocked(
+        spi_master_t *spi,
+        xclock_t clock_block,
+        xclock_t data_clock_block,
+        port_t cs_port,
+        port_t sclk_port,
+        port_t mosi_port,
+        port_t miso_port);
+
 /**
  * Initialize a SPI device. Multiple SPI devices may be initialized per SPI interface.
  * Each must be on a unique pin of the interface's chip select port.
@@ -193,6 +329,73 @@ void spi_master_device_init(
         uint32_t clk_to_cs_delay_ticks,
         uint32_t cs_to_cs_delay_ticks);
 
+/**
+ * Inputs MISO data for transfers made by another thread, so that the thread
+ * calling spi_master_transfer() only has to output SCLK and MOSI. This
+ * allows full-duplex transfers at higher SCLK rates than one thread can
+ * sustain. It does not return until spi_master_set_rx_drain() is called
+ * with 0, so it is run in its own thread on the same tile as the master.
+ *
+ * \param miso_port The SPI interface's MISO port, as given to spi_master_init().
+ * \param c         A streaming channel end connected to the one given to
+ *                  spi_master_set_rx_drain().
+ */
+void spi_master_rx_drain_run(
+        port_t miso_port,
+        chanend_t c);
+
+/**
+ * Sets a thread running spi_master_rx_drain_run() to input the MISO data of
+ * the transfers made by spi_master_transfer() on a SPI master interface.
+ * Other transfer functions continue to input MISO data themselves.
+ *
+ * This is not supported by an interface initialized with
+ * spi_master_init_sclk_clocked().
+ *
+ * \param spi The SPI master interface.
+ * \param c   A streaming channel end connected to the one given to
+ *            spi_master_rx_drain_run(), or 0 to stop the thread currently
+ *            set and input MISO data in the calling thread again.
+ */
+void spi_master_set_rx_drain(
+        spi_master_t *spi,
+        chanend_t c);
+
+/**
+ * Initializes a broadcast group, which asserts the chip selects of several
+ * devices at once so that the same data may be written to all of them in a
+ * single transaction. The group is then used as a device with the other
+ * functions, but only for transfers with no data in, since the members
+ * would all drive MISO.
+ *
+ * The members must be on the same SPI master interface and use the same
+ * clock polarity, clock phase, source clock and clock divisor. The group
+ * uses the longest of the chip select delays of its members.
+ *
+ * \param group       The context representing the group to initialize.
+ * \param members     An array of \p num_members initialized devices.
+ * \param num_members The number of devices in the group, at least 1.
+ *
+ * \returns 1 if the group was initialized, or 0 if the members are not
+ *          compatible.
+ */
+int spi_master_broadcast_init(
+        spi_master_device_t *group,
+        spi_master_device_t *const *members,
+        size_t num_members);
+
+/**
+ * Writes data to every device in a broadcast group in a single transaction.
+ *
+ * \param group    The broadcast group.
+ * \param data_out Buffer containing the data to send.
+ * \param len      The length in bytes of the data to send.
+ */
+void spi_master_broadcast_write(
+        spi_master_device_t *group,
+        uint8_t *data_out,
+        size_t len);
+
 /**
  * Starts a SPI transaction with the specified SPI device. This leaves chip select asserted.
  *
@@ -219,6 +422,557 @@ void spi_master_transfer(
         uint8_t *data_in,
         size_t len);
 
+/**
+ * The number of words required by spi_master_transfer_expanded() to
+ * transfer \p len bytes.
+ */
+#define SPI_MASTER_EXPANDED_WORDS(len) (((len) + 1) / 2)
+
+/**
+ * Transfers data to/from the specified SPI device as spi_master_transfer()
+ * does, but converts all the data to and from the form written to and read
+ * from the ports before and after the transfer, rather than a word at a time
+ * between port operations. The loop that shifts the data then only moves
+ * words between memory and the ports, so it can keep up at higher SCLK
+ * rates, at the cost of an additional buffer and of time spent before the
+ * first SCLK edge and after the last.
+ *
+ * This has no benefit for masters using SCLK clocked data ports, which
+ * transfer as spi_master_transfer() does.
+ *
+ * \param dev      The SPI device with which to transfer data.
+ * \param data_out Buffer containing the data to send to the device.
+ *                 May be NULL if no data needs to be sent.
+ * \param data_in  Buffer to save the data received from the device.
+ *                 May be NULL if the data received is not needed.
+ * \param len      The length in bytes of the data to transfer. Both
+ *                 buffers must be at least this large if not NULL.
+ * \param words    Working buffer of at least SPI_MASTER_EXPANDED_WORDS(len)
+ *                 words. It may not overlap \p data_out or \p data_in.
+ */
+void spi_master_transfer_expanded(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len,
+        uint32_t *words);
+
+/**
+ * Initializes a CRC accumulator. The CRC is calculated MSB first over the
+ * bytes in the order they appear on the wire, as used by SD cards in SPI
+ * mode (CRC7 0x09, CRC16 0x1021) and most other SPI devices with CRC framing.
+ * A CRC may be carried across several transfers, so it is normally
+ * initialized once at the start of each transaction.
+ *
+ * \param crc   The CRC accumulator to initialize.
+ * \param poly  The generator polynomial in normal (non-reflected) form,
+ *              without the implicit top bit. For example 0x09 for CRC7.
+ * \param width The width of the CRC in bits, between 1 and 32.
+ * \param init  The initial value of the CRC register.
+ */
+void spi_crc_init(
+        spi_crc_t *crc,
+        uint32_t poly,
+        uint32_t width,
+        uint32_t init);
+
+/**
+ * Returns the CRC of all data transmitted since spi_crc_init().
+ *
+ * \param crc The CRC accumulator.
+ *
+ * \returns The CRC, right aligned in \p width bits.
+ */
+uint32_t spi_crc_tx_result(
+        const spi_crc_t *crc);
+
+/**
+ * Returns the CRC of all data received since spi_crc_init().
+ *
+ * \param crc The CRC accumulator.
+ *
+ * \returns The CRC, right aligned in \p width bits.
+ */
+uint32_t spi_crc_rx_result(
+        const spi_crc_t *crc);
+
+/**
+ * Transfers data to/from the specified SPI device as spi_master_transfer()
+ * does, accumulating the CRC of the data sent and received as it is shifted
+ * so that the buffers do not need to be processed a second time. Each CRC is
+ * only updated when the corresponding buffer is not NULL.
+ *
+ * \param dev      The SPI device with which to transfer data.
+ * \param data_out Buffer containing the data to send to the device.
+ *                 May be NULL if no data needs to be sent.
+ * \param data_in  Buffer to save the data received from the device.
+ *                 May be NULL if the data received is not needed.
+ * \param len      The length in bytes of the data to transfer. Both
+ *                 buffers must be at least this large if not NULL.
+ * \param crc      The CRC accumulator to update.
+ */
+void spi_master_transfer_crc(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len,
+        spi_crc_t *crc);
+
+/**
+ * Enables or disables automatic SCLK back-off for a device.
+ *
+ * spi_master_transfer(), spi_master_transfer_crc() and split-phase
+ * transfers started by spi_master_transfer_start() check the port
+ * timestamps at the end of each transfer against the schedule the ports
+ * should have followed. A mismatch means the thread did not refill the
+ * ports in time, so SCLK stalled part way through while MISO continued to
+ * be sampled, and the data may be corrupt. Each such transfer is counted
+ * against the device, see spi_master_timing_error_count().
+ *
+ * With back-off enabled, a timing error also increases the device's clock
+ * divisor by one, to the next slower SCLK rate, from the following
+ * transfer on. After \p retry_transfers transfers without error the
+ * divisor is reduced by one again, until the divisor given to
+ * spi_master_device_init() is reached. Transfers on an interface
+ * initialized with spi_master_init_sclk_clocked() cannot fall behind in
+ * this way and are not checked.
+ *
+ * \param dev             The SPI device.
+ * \param retry_transfers The number of error free transfers after which a
+ *                        faster SCLK rate is tried again, or 0 to disable
+ *                        the back-off.
+ */
+void spi_master_set_clock_backoff(
+        spi_master_device_t *dev,
+        uint32_t retry_transfers);
+
+/**
+ * Returns the number of transfers with the device which fell behind the
+ * port schedule since spi_master_device_init().
+ *
+ * \param dev The SPI device.
+ */
+uint32_t spi_master_timing_error_count(
+        const spi_master_device_t *dev);
+
+/**
+ * Enables or disables real-time mode for a SPI master. In real-time mode,
+ * spi_master_start_transaction() sets the fast mode bit of the calling
+ * thread, and on xcore.ai its high priority bit, and
+ * spi_master_end_transaction() clears whichever of them it set. The
+ * thread is then scheduled ahead of other threads on the tile while it
+ * drives the bus, at the cost of the instructions those threads get.
+ * It must be changed between transactions.
+ *
+ * \param spi    The SPI master context.
+ * \param enable 1 to enable real-time mode, 0 to disable it.
+ */
+void spi_master_set_realtime(
+        spi_master_t *spi,
+        int enable);
+
+/**
+ * Returns the worst lateness of the SPI master's edges against their
+ * schedule since spi_master_init() or spi_master_reset_lateness().
+ *
+ * The CS lateness is how far the CS deassert which
+ * spi_master_end_transaction() outputs went out after the end of the
+ * device's clock to CS delay. It is only measured when
+ * spi_master_end_transaction() was called before the delay ended, so that
+ * the deassert was waiting on that edge, and not when the caller itself
+ * came later. The SCLK lateness is how far the last port words of a
+ * transfer went out after they were due, as for
+ * spi_master_timing_error_count(). Both show the effect of other threads
+ * on the tile and of real-time mode on edges the thread had scheduled.
+ *
+ * \param spi The SPI master context.
+ */
+spi_master_lateness_t spi_master_lateness(
+        const spi_master_t *spi);
+
+/**
+ * Clears the worst lateness returned by spi_master_lateness().
+ *
+ * \param spi The SPI master context.
+ */
+void spi_master_reset_lateness(
+        spi_master_t *spi);
+
+/**
+ * Returns the clock divisor currently used for the device, which is larger
+ * than the one given to spi_master_device_init() while backed off.
+ *
+ * \param dev The SPI device.
+ */
+uint32_t spi_master_current_clock_divisor(
+        const spi_master_device_t *dev);
+
+/**
+ * Starts a transfer to/from the specified SPI device and returns as soon as
+ * the first port word has been loaded, leaving the calling thread free to do
+ * other work while the transfer is on the wire.
+ *
+ * The transfer must then be progressed by calling spi_master_transfer_poll()
+ * often enough to keep the ports fed (at least once per 16 SCLK periods),
+ * or completed by calling spi_master_transfer_wait(). No other SPI master
+ * function may be called on the same interface until the transfer has
+ * completed. The buffers must remain valid until then. A transfer which
+ * was not polled often enough is counted as a timing error, see
+ * spi_master_set_clock_backoff().
+ *
+ * On an interface initialized with spi_master_init_sclk_clocked() the
+ * transfer is completed before this function returns.
+ *
+ * \param dev      The SPI device with which to transfer data.
+ * \param data_out Buffer containing the data to send to the device.
+ *                 May be NULL if no data needs to be sent.
+ * \param data_in  Buffer to save the data received from the device.
+ *                 May be NULL if the data received is not needed.
+ * \param len      The length in bytes of the data to transfer. Both
+ *                 buffers must be at least this large if not NULL.
+ */
+void spi_master_transfer_start(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len);
+
+/**
+ * Progresses a transfer started by spi_master_transfer_start() without
+ * blocking. Any port refills and reads that are due are performed and the
+ * function returns immediately.
+ *
+ * \param dev The SPI device passed to spi_master_transfer_start().
+ *
+ * \returns 1 once the transfer has completed, otherwise 0.
+ */
+int spi_master_transfer_poll(
+        spi_master_device_t *dev);
+
+/**
+ * Blocks until a transfer started by spi_master_transfer_start()
+ * has completed.
+ *
+ * \param dev The SPI device passed to spi_master_transfer_start().
+ */
+void spi_master_transfer_wait(
+        spi_master_device_t *dev);
+
+/**
+ * Struct to hold the state of a continuous capture started by
+ * spi_master_capture_run().
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct {
+    spi_master_device_t *dev;
+    uint8_t *buffer[2];
+    size_t buffer_len;
+    size_t sample_len;           /* Bytes per chip select assertion, or 0 to read continuously */
+    SPI_VOLATILE int buffer_busy[2]; /* Set while a buffer is held by the consumer */
+    SPI_VOLATILE int stop;
+    SPI_VOLATILE uint32_t buffers_captured;
+    SPI_VOLATILE uint32_t overruns;
+} spi_master_capture_t;
+
+/**
+ * Initializes a capture context, which reads from a device into two
+ * alternating buffers. Each full buffer is handed to a consumer by
+ * spi_master_capture_run() and must be given back with
+ * spi_master_capture_release() before it can be filled again.
+ *
+ * \param capture    The capture context to initialize.
+ * \param dev        The SPI device to read from. Only MISO is used.
+ * \param buffer_0   The first buffer to capture into.
+ * \param buffer_1   The second buffer to capture into.
+ * \param buffer_len The length in bytes of each buffer.
+ * \param sample_len The number of bytes to read per chip select assertion.
+ *                   Must divide \p buffer_len. If 0, chip select is held
+ *                   asserted for the whole capture and SCLK runs continuously
+ *                   apart from a short pause between buffers.
+ */
+void spi_master_capture_init(
+        spi_master_capture_t *capture,
+        spi_master_device_t *dev,
+        uint8_t *buffer_0,
+        uint8_t *buffer_1,
+        size_t buffer_len,
+        size_t sample_len);
+
+/**
+ * Captures into the buffers of a capture context until spi_master_capture_stop()
+ * is called. This does not return until then, so it is normally run in its
+ * own thread.
+ *
+ * Each time a buffer is filled, a pointer to it is output as a word on the
+ * streaming channel end \p c_consumer and capturing continues into the other
+ * buffer. If the consumer has not yet released the other buffer, the buffer
+ * just filled is captured into again instead and the overrun count is
+ * incremented. A NULL pointer is output once capturing has stopped.
+ *
+ * \param capture    The capture context.
+ * \param c_consumer The streaming channel end to output full buffers on.
+ */
+void spi_master_capture_run(
+        spi_master_capture_t *capture,
+        chanend_t c_consumer);
+
+/**
+ * Gives a buffer received from spi_master_capture_run() back to be
+ * captured into again. This may be called from any thread on the same tile.
+ *
+ * \param capture The capture context.
+ * \param buffer  The buffer to release.
+ */
+void spi_master_capture_release(
+        spi_master_capture_t *capture,
+        uint8_t *buffer);
+
+/**
+ * Requests that spi_master_capture_run() stops once the buffer it is
+ * currently filling is full. This may be called from any thread on the
+ * same tile.
+ *
+ * \param capture The capture context.
+ */
+void spi_master_capture_stop(
+        spi_master_capture_t *capture);
+
+/**
+ * Returns the number of buffers filled since spi_master_capture_init(),
+ * including those lost to overruns.
+ *
+ * \param capture The capture context.
+ */
+uint32_t spi_master_capture_buffer_count(
+        const spi_master_capture_t *capture);
+
+/**
+ * Returns the number of buffers lost since spi_master_capture_init()
+ * because the consumer had not released the other buffer in time.
+ *
+ * \param capture The capture context.
+ */
+uint32_t spi_master_capture_overrun_count(
+        const spi_master_capture_t *capture);
+
+/**
+ * Struct type representing a request submitted to a spi_master_queue_t.
+ * Each request is a complete transaction with a single transfer.
+ */
+typedef struct {
+    spi_master_device_t *dev;  /**< The device to transfer with */
+    uint8_t *data_out;         /**< Data to send, or NULL */
+    uint8_t *data_in;          /**< Buffer for received data, or NULL */
+    size_t len;                /**< The length in bytes of the transfer */
+    SPI_VOLATILE int done;     /**< Set once the transaction has completed. See spi_master_request_done() */
+} spi_master_request_t;
+
+/**
+ * Struct to hold the requests of one producer of a spi_master_queue_t.
+ * Only its producer writes head and only the worker writes tail, so
+ * neither side needs a lock.
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct {
+    spi_master_request_t *SPI_VOLATILE slot[SPI_MASTER_QUEUE_DEPTH];
+    SPI_VOLATILE uint32_t head;
+    SPI_VOLATILE uint32_t tail;
+    chanend_t c_notify;
+} spi_master_queue_ring_t;
+
+/**
+ * Struct to hold a queue of requests from several threads on the same
+ * tile to a single SPI master, served by spi_master_queue_run().
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct {
+    spi_master_queue_ring_t *rings;
+    size_t num_producers;
+    SPI_VOLATILE int stop;
+} spi_master_queue_t;
+
+/**
+ * Initializes a request queue.
+ *
+ * \param queue         The queue to initialize.
+ * \param rings         An array of \p num_producers rings, one for each
+ *                      thread that will submit requests.
+ * \param num_producers The number of producers.
+ */
+void spi_master_queue_init(
+        spi_master_queue_t *queue,
+        spi_master_queue_ring_t *rings,
+        size_t num_producers);
+
+/**
+ * Sets a streaming channel end for the queue to notify a producer on when
+ * its requests complete. Completions are coalesced: after serving all the
+ * requests that were pending for a producer, the number completed is
+ * output once as a word. By default producers are not notified and should
+ * poll the done flag of each request.
+ *
+ * \param queue    The queue.
+ * \param producer The index of the producer.
+ * \param c_notify The streaming channel end to notify on, or 0 for none.
+ */
+void spi_master_queue_set_notify(
+        spi_master_queue_t *queue,
+        size_t producer,
+        chanend_t c_notify);
+
+/**
+ * Submits a request to a queue without blocking. The request and its
+ * buffers must remain valid until its done flag is set.
+ *
+ * \param queue    The queue.
+ * \param producer The index of the calling producer. Each producer index
+ *                 must only be used by one thread.
+ * \param request  The request to submit.
+ *
+ * \returns 1 if the request was queued, or 0 if the producer already has
+ *          SPI_MASTER_QUEUE_DEPTH requests outstanding.
+ */
+int spi_master_queue_submit(
+        spi_master_queue_t *queue,
+        size_t producer,
+        spi_master_request_t *request);
+
+/**
+ * Returns whether a request submitted to a queue has completed.
+ *
+ * \param request The request.
+ *
+ * \returns 1 once the transaction has completed, otherwise 0.
+ */
+int spi_master_request_done(
+        const spi_master_request_t *request);
+
+/**
+ * Serves the requests in a queue until spi_master_queue_stop() is called.
+ * Producers are served in turn, each having all of its pending requests
+ * completed before moving on. This polls continuously, so it is normally
+ * run in its own thread.
+ *
+ * \param queue The queue.
+ */
+void spi_master_queue_run(
+        spi_master_queue_t *queue);
+
+/**
+ * Requests that spi_master_queue_run() returns once no requests are pending.
+ *
+ * \param queue The queue.
+ */
+void spi_master_queue_stop(
+        spi_master_queue_t *queue);
+
+/**
+ * Struct to hold a daisy chain of devices which share one chip select,
+ * with data for each device shifted through the devices before it.
+ *
+ * The members in this struct should not be accessed directly.
+ */
+typedef struct {
+    spi_master_device_t *dev;
+    const size_t *link_bytes;
+    size_t num_links;
+    uint8_t *frame;             /* Data to send to the whole chain, in the order it is sent */
+    uint8_t *frame_in;          /* Data returned by the whole chain, or NULL */
+    size_t frame_len;
+} spi_master_daisy_chain_t;
+
+/**
+ * Initializes a daisy chain. Link 0 is the device whose data input is
+ * connected to MOSI, and the last link is the device whose data output is
+ * connected to MISO, if any. The image of each link is initially zero.
+ *
+ * Data for the last link is sent first, so that once the whole frame has
+ * been shifted each device holds its own data. The data returned is the
+ * previous contents of the devices, and so is split between the links in
+ * the same way.
+ *
+ * \param chain      The daisy chain to initialize.
+ * \param dev        The SPI device for the chip select shared by the chain.
+ * \param link_bytes An array of \p num_links frame lengths in bytes, one for
+ *                   each link. This must remain valid while the chain is used.
+ * \param num_links  The number of devices in the chain.
+ * \param frame      Buffer to hold the image of the chain. It must be at
+ *                   least the sum of \p link_bytes bytes.
+ * \param frame_in   Buffer of the same size as \p frame to save the data
+ *                   returned by the chain, or NULL if it is not needed.
+ */
+void spi_master_daisy_chain_init(
+        spi_master_daisy_chain_t *chain,
+        spi_master_device_t *dev,
+        const size_t *link_bytes,
+        size_t num_links,
+        uint8_t *frame,
+        uint8_t *frame_in);
+
+/**
+ * Returns the image of one link within the frame of a chain, so that it
+ * may be modified in place before calling spi_master_daisy_chain_update().
+ *
+ * \param chain The daisy chain.
+ * \param link  The index of the link.
+ *
+ * \returns A pointer to the link_bytes[link] bytes sent to the link.
+ */
+uint8_t *spi_master_daisy_chain_link(
+        spi_master_daisy_chain_t *chain,
+        size_t link);
+
+/**
+ * Returns the data returned by one link during the last update.
+ *
+ * \param chain The daisy chain.
+ * \param link  The index of the link.
+ *
+ * \returns A pointer to the link_bytes[link] bytes received from the link,
+ *          or NULL if the chain was initialized without \p frame_in.
+ */
+const uint8_t *spi_master_daisy_chain_link_in(
+        const spi_master_daisy_chain_t *chain,
+        size_t link);
+
+/**
+ * Sets the image of one link without sending it.
+ *
+ * \param chain The daisy chain.
+ * \param link  The index of the link.
+ * \param data  The link_bytes[link] bytes to send to the link.
+ */
+void spi_master_daisy_chain_set(
+        spi_master_daisy_chain_t *chain,
+        size_t link,
+        const uint8_t *data);
+
+/**
+ * Sends the image of every link to the chain in a single transaction,
+ * saving the data returned if the chain has a \p frame_in buffer.
+ *
+ * \param chain The daisy chain.
+ */
+void spi_master_daisy_chain_update(
+        spi_master_daisy_chain_t *chain);
+
+/**
+ * Sets the image of one link and sends the image of every link to the
+ * chain, as spi_master_daisy_chain_set() followed by
+ * spi_master_daisy_chain_update().
+ *
+ * \param chain The daisy chain.
+ * \param link  The index of the link.
+ * \param data  The link_bytes[link] bytes to send to the link.
+ */
+void spi_master_daisy_chain_write(
+        spi_master_daisy_chain_t *chain,
+        size_t link,
+        const uint8_t *data);
+
 #ifndef __XC__
 
 /**
@@ -232,6 +986,39 @@ static inline void blocking_wait_ticks(uint32_t delay_ticks){
     while(!timeafter(get_reference_time(), wait_time));
 }
 
+/**
+ * Outputs the specified value on CS now and schedules it to be output
+ * again after a delay, so that a subsequent port_sync() on CS enforces
+ * the delay. This never busy waits: delays below SPI_MASTER_MINIMUM_DELAY
+ * are rounded up to it, which is permitted as all SPI master delays are
+ * minimums.
+ *
+ * \param spi         The SPI master context.
+ * \param cs_val      The value to output on the CS port.
+ * \param delay_ticks The number of reference clock ticks to delay.
+ *
+ * \returns the port time at which the value was first output.
+ */
+static inline uint32_t spi_master_schedule_cs(
+        spi_master_t *spi,
+        uint32_t cs_val,
+        uint32_t delay_ticks)
+{
+    uint32_t output_time;
+
+    port_out(spi->cs_port, cs_val);
+    port_sync(spi->cs_port);
+    output_time = port_get_trigger_time(spi->cs_port);
+
+    if (delay_ticks < SPI_MASTER_MINIMUM_DELAY) {
+        delay_ticks = SPI_MASTER_MINIMUM_DELAY;
+    }
+    port_out_at_time(spi->cs_port, output_time + delay_ticks, cs_val);
+    spi->cs_due_time = get_reference_time() + delay_ticks;
+
+    return output_time;
+}
+
 /**
  * Enforces a minimum delay between the time this is called and
  * the next transfer. It must be called during a transaction.
@@ -250,19 +1037,11 @@ static inline void spi_master_delay_before_next_transfer(
 
     port_clear_trigger_time(spi->cs_port);
 
-    /* Assert CS now */
-    port_out(spi->cs_port, dev->cs_assert_val);
-    port_sync(spi->cs_port);
-
     /*
-     * Assert CS again, scheduled for earliest time the
-     * next transfer is allowed to start.
+     * Assert CS now, and again scheduled for the earliest
+     * time the next transfer is allowed to start.
      */
-    if (delay_ticks >= SPI_MASTER_MINIMUM_DELAY) {
-        port_out_at_time(spi->cs_port, port_get_trigger_time(spi->cs_port) + delay_ticks, dev->cs_assert_val);
-    } else {
-        blocking_wait_ticks(dev->clk_to_cs_delay_ticks);
-    }
+    spi_master_schedule_cs(spi, dev->cs_assert_val, delay_ticks);
 }
 #endif
 /**
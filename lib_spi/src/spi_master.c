@@ -4,15 +4,47 @@
 #include <print.h>
 #include "spi_fwk.h"
 #include <xcore/hwtimer.h>
+#include <xcore/channel_streaming.h>
 
+/* The thread mode bits set in real-time mode. Only xcore.ai has thread priority. */
+#if defined(__XS3A__)
+#define SPI_MASTER_REALTIME_MODE (thread_mode_fast | thread_mode_high_priority)
+#else
+#define SPI_MASTER_REALTIME_MODE (thread_mode_fast)
+#endif
+
+/*
+ * Sets the real-time mode bits of the calling thread and returns those which
+ * were already set, for spi_master_realtime_exit(). Also used by the
+ * clock-blockless spi_master() task.
+ */
+uint32_t spi_master_realtime_enter(void)
+{
+    uint32_t saved = local_thread_mode_get_bits() & SPI_MASTER_REALTIME_MODE;
+
+    local_thread_mode_set_bits(SPI_MASTER_REALTIME_MODE);
+    return saved;
+}
+
+/* Clears the real-time mode bits which spi_master_realtime_enter() set */
+void spi_master_realtime_exit(uint32_t saved)
+{
+    local_thread_mode_clear_bits(SPI_MASTER_REALTIME_MODE & ~saved);
+}
 
 void spi_master_start_transaction(
         spi_master_device_t *dev)
 {
     spi_master_t *spi = dev->spi_master_ctx;
 
-    if (dev->cs_assert_val != spi->current_device) {
+    if (spi->realtime) {
+        spi->saved_thread_mode = spi_master_realtime_enter();
+    }
+
+    if (dev->cs_assert_val != spi->current_device || spi->current_device_stale) {
+        const int same_device = dev->cs_assert_val == spi->current_device;
         spi->current_device = dev->cs_assert_val;
+        spi->current_device_stale = 0;
 
         if (dev->source_clock == spi_master_source_clock_ref) {
             clock_set_source_clk_ref(spi->clock_block);
@@ -22,26 +54,55 @@ void spi_master_start_transaction(
         clock_set_divide(spi->clock_block, dev->clock_divisor);
 
         if (spi->miso_port != 0) {
-            if ((dev->miso_sample_delay & 1) == 0) {
-                port_set_sample_falling_edge(spi->miso_port);
-            } else {
-                port_set_sample_rising_edge(spi->miso_port);
+            /* When clocked by SCLK, MISO is always sampled on the rising edge */
+            if (spi->data_clock_block == 0) {
+                if ((dev->miso_sample_delay & 1) == 0) {
+                    port_set_sample_falling_edge(spi->miso_port);
+                } else {
+                    port_set_sample_rising_edge(spi->miso_port);
+                }
             }
             SPI_IO_RESOURCE_SETC(spi->miso_port, SPI_IO_SETC_PAD_DELAY(dev->miso_pad_delay));
         }
 
+        if (spi->data_clock_block != 0) {
+            if (dev->sclk_invert) {
+                port_set_invert(spi->sclk_port);
+            } else {
+                port_set_no_invert(spi->sclk_port);
+            }
+        }
+
         /* Output the clock idle value */
         clock_start(spi->clock_block);
         spi_io_port_outpw(spi->sclk_port, dev->clock_bits >> 1, 1);
         port_sync(spi->sclk_port);
         clock_stop(spi->clock_block);
 
-        /*
-         * This transaction is with a different chip
-         * than last time, so there is no need to wait
-         * for the minimum CS to CS time.
-         */
-        port_clear_trigger_time(spi->cs_port);
+        if (spi->data_clock_block != 0) {
+            /* A change of idle level is an edge on the data clock, so discard what it shifted */
+            if (spi->mosi_port != 0) {
+                port_clear_buffer(spi->mosi_port);
+            }
+            if (spi->miso_port != 0) {
+                port_clear_buffer(spi->miso_port);
+            }
+        }
+
+        if (same_device) {
+            /*
+             * The chip was re-initialized with new settings,
+             * but the minimum CS to CS time still applies.
+             */
+            port_sync(spi->cs_port);
+        } else {
+            /*
+             * This transaction is with a different chip
+             * than last time, so there is no need to wait
+             * for the minimum CS to CS time.
+             */
+            port_clear_trigger_time(spi->cs_port);
+        }
     } else {
         /*
          * This ensures that the CS_high to CS_low
@@ -75,7 +136,7 @@ inline uint32_t load_data_out(
 }
 
 __attribute__((always_inline))
-inline void save_data_in(
+inline uint32_t save_data_in(
         uint8_t *data_in,
         uint32_t word_in,
         size_t bytes)
@@ -90,30 +151,62 @@ inline void save_data_in(
         data_in[1] = word_in;
         data_in[0] = (word_in >> 8) & 0xFF;
     }
+    return word_in;
 }
 
-void spi_master_transfer(
-        spi_master_device_t *dev,
-        uint8_t *data_out,
-        uint8_t *data_in,
-        size_t len)
+/*
+ * Accumulates one or two bytes into a CRC. The bytes are packed MSB first
+ * as in load_data_out(), and are bit reversed so that the reflected crc8
+ * instruction processes them in the order they appear on the wire.
+ */
+__attribute__((always_inline))
+static inline void crc_update(
+        uint32_t *crc,
+        uint32_t bytes_msb_first,
+        size_t bytes,
+        uint32_t poly)
 {
-    const uint32_t start_time = 1;
-    spi_master_t *spi = dev->spi_master_ctx;
-    uint32_t word_count;
-    uint32_t remainder;
-    uint32_t tw;
-    uint32_t word;
-    const int do_output = data_out != NULL && spi->mosi_port != 0;
-    const int do_input = data_in != NULL && spi->miso_port != 0;
+    uint32_t data;
 
-    if (len == 0) {
-        return;
+    if (bytes == 1) {
+        data = bitrev(bytes_msb_first) >> 24;
+        spi_crc8(crc, data, poly);
+    } else {
+        data = bitrev(bytes_msb_first) >> 16;
+        data = spi_crc8(crc, data, poly);
+        spi_crc8(crc, data, poly);
     }
+}
 
-    word_count = len / sizeof(uint16_t);
-    remainder = len & sizeof(uint16_t) - 1; /* get the byte remainder */
+__attribute__((always_inline))
+static inline uint32_t pack_data_out(
+        const uint8_t *data_out,
+        size_t bytes)
+{
+    return bytes == 1 ? data_out[0] : ((uint32_t)data_out[0] << 8) | data_out[1];
+}
+
+/* Accumulates a whole buffer into a CRC, for transfers which cannot do so as they shift */
+static void crc_update_buffer(
+        uint32_t *crc,
+        const uint8_t *data,
+        size_t len,
+        uint32_t poly)
+{
+    size_t i;
+
+    for (i = 0; i + 1 < len; i += 2) {
+        crc_update(crc, pack_data_out(&data[i], 2), 2, poly);
+    }
+    if (i < len) {
+        crc_update(crc, pack_data_out(&data[i], 1), 1, poly);
+    }
+}
 
+__attribute__((always_inline))
+static inline void transfer_wait_cs(
+        spi_master_t *spi)
+{
     if (spi->delay_before_transfer) {
         /* Ensure the delay time is met */
         port_sync(spi->cs_port);
@@ -121,6 +214,21 @@ void spi_master_transfer(
     } else {
         port_clear_trigger_time(spi->cs_port);
     }
+}
+
+__attribute__((always_inline))
+static inline void transfer_begin(
+        spi_master_device_t *dev,
+        uint32_t first_word_out,
+        size_t len,
+        const int do_output,
+        const int do_input)
+{
+    const uint32_t start_time = 1;
+    spi_master_t *spi = dev->spi_master_ctx;
+    uint32_t tw;
+
+    transfer_wait_cs(spi);
 
     port_set_trigger_time(spi->sclk_port, start_time + dev->clock_delay);
 
@@ -133,14 +241,114 @@ void spi_master_transfer(
     spi_io_port_outpw(spi->sclk_port, dev->clock_bits, tw);
 
     if (do_output) {
-        spi_io_port_outpw(spi->mosi_port, load_data_out(data_out, len), tw);
-        data_out += 2;
+        spi_io_port_outpw(spi->mosi_port, first_word_out, tw);
     }
     if (do_input) {
         port_set_trigger_time(spi->miso_port, start_time + (tw - 2) + dev->miso_initial_trigger_delay);
     }
 
     clock_start(spi->clock_block);
+}
+
+__attribute__((always_inline))
+static inline void transfer_complete(
+        spi_master_device_t *dev)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+
+    port_sync(spi->sclk_port);
+    clock_stop(spi->clock_block);
+
+    /*
+     * Assert CS again now, and again scheduled for the
+     * earliest time CS is allowed to deassert.
+     */
+    spi_master_schedule_cs(spi, dev->cs_assert_val, dev->clk_to_cs_delay_ticks);
+}
+
+/*
+ * Compares the timestamps of the last SCLK and MOSI port words of a
+ * transfer with when they were scheduled to go out. Every port word is
+ * 16 SCLK periods, so if the ports were kept fed the last one started
+ * (len + 1) / 2 - 1 words after the start time. A later timestamp means
+ * SCLK stalled while MISO was still being sampled. Only the kernels driven
+ * by clock_block, and transfer_end() for split-phase transfers, call this. Transfers on an interface initialized with
+ * spi_master_init_sclk_clocked() never reach it, as MOSI and MISO are
+ * clocked by SCLK itself and so cannot fall behind it.
+ */
+__attribute__((always_inline))
+static inline void transfer_check_schedule(
+        spi_master_device_t *dev,
+        size_t len,
+        const int do_output)
+{
+    const uint32_t start_time = 1;
+    spi_master_t *spi = dev->spi_master_ctx;
+    uint32_t last_word_time = start_time + 32 * ((len + 1) / 2 - 1);
+    uint32_t late;
+
+    late = (uint16_t)(port_get_trigger_time(spi->sclk_port) - (last_word_time + dev->clock_delay));
+    if (do_output) {
+        uint32_t mosi_late = (uint16_t)(port_get_trigger_time(spi->mosi_port) - last_word_time);
+        if (mosi_late > late) {
+            late = mosi_late;
+        }
+    }
+    if (late > spi->sclk_late_max) {
+        spi->sclk_late_max = late;
+    }
+
+    if (late) {
+        dev->timing_error_count++;
+        dev->clock_backoff_count = 0;
+        if (dev->clock_backoff_retry != 0 && dev->clock_divisor < 255) {
+            /* The clock is stopped between transfers, so it is safe to change now */
+            dev->clock_divisor++;
+            clock_set_divide(spi->clock_block, dev->clock_divisor);
+        }
+    } else if (dev->clock_divisor != dev->nominal_clock_divisor) {
+        if (++dev->clock_backoff_count >= dev->clock_backoff_retry) {
+            dev->clock_backoff_count = 0;
+            dev->clock_divisor--;
+            clock_set_divide(spi->clock_block, dev->clock_divisor);
+        }
+    }
+}
+
+/*
+ * The body of spi_master_transfer(). When crc is NULL all of the CRC
+ * handling is removed at compile time, so spi_master_transfer() is
+ * unaffected by spi_master_transfer_crc() sharing this loop. Likewise
+ * when do_output and do_input are constants the direction tests are
+ * removed from the loop, giving a branch-free kernel per direction.
+ */
+__attribute__((always_inline))
+static inline void transfer_kernel(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len,
+        spi_crc_t *crc,
+        const int do_output,
+        const int do_input)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    uint32_t word_count;
+    uint32_t remainder;
+    uint32_t word;
+
+    if (len == 0) {
+        return;
+    }
+
+    word_count = len / sizeof(uint16_t);
+    remainder = len & sizeof(uint16_t) - 1; /* get the byte remainder */
+
+    transfer_begin(dev, do_output ? load_data_out(data_out, len) : 0, len, do_output, do_input);
+    if (crc != NULL && do_output) {
+        crc_update(&crc->tx, pack_data_out(data_out, len == 1 ? 1 : 2), len == 1 ? 1 : 2, crc->poly);
+    }
+    data_out += 2;
 
     if (word_count > 0) {
         while (word_count-- != 1) {
@@ -152,7 +360,13 @@ void spi_master_transfer(
             }
             if (do_input) {
                 word = port_in(spi->miso_port);
-                save_data_in(data_in, word, 2);
+                word = save_data_in(data_in, word, 2);
+                if (crc != NULL) {
+                    crc_update(&crc->rx, word, 2, crc->poly);
+                }
+            }
+            if (crc != NULL && do_output) {
+                crc_update(&crc->tx, pack_data_out(data_out, 2), 2, crc->poly);
             }
             data_out += 2;
             data_in += 2;
@@ -168,125 +382,965 @@ void spi_master_transfer(
             if (do_input) {
                 word = port_in(spi->miso_port);
                 port_set_shift_count(spi->miso_port, 16);
-                save_data_in(data_in, word, 2);
+                word = save_data_in(data_in, word, 2);
+                if (crc != NULL) {
+                    crc_update(&crc->rx, word, 2, crc->poly);
+                }
                 data_in += 2;
             }
+            if (crc != NULL && do_output) {
+                crc_update(&crc->tx, pack_data_out(data_out, 1), 1, crc->poly);
+            }
         }
     }
 
     if (do_input) {
         word = port_in(spi->miso_port);
-        save_data_in(data_in, word, remainder);
+        word = save_data_in(data_in, word, remainder);
+        if (crc != NULL) {
+            crc_update(&crc->rx, word, remainder ? 1 : 2, crc->poly);
+        }
     }
 
-    port_sync(spi->sclk_port);
-    clock_stop(spi->clock_block);
+    transfer_complete(dev);
+    transfer_check_schedule(dev, len, do_output);
+}
 
-    /* Assert CS again now */
-    port_out(spi->cs_port, dev->cs_assert_val);
-    port_sync(spi->cs_port);
+/*
+ * As transfer_kernel(), but with the MISO data input by the thread running
+ * spi_master_rx_drain_run(). That thread blocks on the MISO port, so it is
+ * kept in step with this one by the port timing alone, and is only given
+ * the transfer once MISO has been set up to start with SCLK.
+ */
+__attribute__((always_inline))
+static inline void transfer_kernel_rx_drain(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len,
+        const int do_output)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    uint32_t word_count;
+    uint32_t remainder;
 
-    /*
-     * And assert CS again, scheduled for earliest time CS
-     * is allowed to deassert.
-     */
-    if (dev->clk_to_cs_delay_ticks >= SPI_MASTER_MINIMUM_DELAY) {
-        // Use port time
-        port_out_at_time(spi->cs_port, port_get_trigger_time(spi->cs_port) + dev->clk_to_cs_delay_ticks, dev->cs_assert_val);
-    } else {
-        blocking_wait_ticks(dev->clk_to_cs_delay_ticks);
+    if (len == 0) {
+        return;
+    }
+
+    word_count = len / sizeof(uint16_t);
+    remainder = len & sizeof(uint16_t) - 1; /* get the byte remainder */
+
+    transfer_begin(dev, do_output ? load_data_out(data_out, len) : 0, len, do_output, 1);
+    s_chan_out_word(spi->rx_drain, (uint32_t) data_in);
+    s_chan_out_word(spi->rx_drain, len);
+    data_out += 2;
+
+    if (word_count > 0) {
+        while (word_count-- != 1) {
+            port_out(spi->sclk_port, dev->clock_bits);
+            if (do_output) {
+                port_out(spi->mosi_port, load_data_out(data_out, 2));
+            }
+            data_out += 2;
+        }
+
+        if (remainder > 0) {
+            spi_io_port_outpw(spi->sclk_port, dev->clock_bits, 16);
+            if (do_output) {
+                spi_io_port_outpw(spi->mosi_port, load_data_out(data_out, 1), 16);
+            }
+        }
     }
+
+    /* Wait for the last MISO word to be saved */
+    (void) s_chan_in_word(spi->rx_drain);
+
+    transfer_complete(dev);
+    transfer_check_schedule(dev, len, do_output);
 }
 
-void spi_master_end_transaction(
-        spi_master_device_t *dev)
+/*
+ * As transfer_kernel(), but with the MOSI data already in port word form
+ * and the MISO data left in port word form, one word per two bytes. The
+ * loop only moves words between memory and the ports. MOSI words are read
+ * one ahead of MISO words being written, so words_out and words_in may be
+ * the same buffer.
+ */
+__attribute__((always_inline))
+static inline void transfer_kernel_expanded(
+        spi_master_device_t *dev,
+        const uint32_t *words_out,
+        uint32_t *words_in,
+        size_t len,
+        const int do_output,
+        const int do_input)
 {
-    const uint32_t cs_deassert_val = 0xFFFFFFFF;
     spi_master_t *spi = dev->spi_master_ctx;
+    uint32_t word_count;
+    uint32_t remainder;
 
-    port_sync(spi->cs_port);
+    if (len == 0) {
+        return;
+    }
 
-    port_out(spi->cs_port, cs_deassert_val);
-    port_sync(spi->cs_port);
+    word_count = len / sizeof(uint16_t);
+    remainder = len & sizeof(uint16_t) - 1; /* get the byte remainder */
 
-    /*
-     * Deassert CS again, scheduled for earliest time CS
-     * is allowed to be re-asserted. The next transaction
-     * will sync on CS before starting to ensure the minimum
-     * CS to CS time is met.
-     */
-    if (dev->cs_to_cs_delay_ticks >= SPI_MASTER_MINIMUM_DELAY) {
-        port_out_at_time(spi->cs_port, port_get_trigger_time(spi->cs_port) + dev->cs_to_cs_delay_ticks, cs_deassert_val);
-    } else {
-        blocking_wait_ticks(dev->clk_to_cs_delay_ticks);
+    transfer_begin(dev, do_output ? words_out[0] : 0, len, do_output, do_input);
+    words_out++;
+
+    if (word_count > 0) {
+        while (word_count-- != 1) {
+            port_out(spi->sclk_port, dev->clock_bits);
+            if (do_output) {
+                port_out(spi->mosi_port, *words_out++);
+            }
+            if (do_input) {
+                *words_in++ = port_in(spi->miso_port);
+            }
+        }
+
+        if (remainder > 0) {
+            spi_io_port_outpw(spi->sclk_port, dev->clock_bits, 16);
+            if (do_output) {
+                spi_io_port_outpw(spi->mosi_port, *words_out, 16);
+            }
+            if (do_input) {
+                *words_in++ = port_in(spi->miso_port);
+                port_set_shift_count(spi->miso_port, 16);
+            }
+        }
     }
+
+    if (do_input) {
+        *words_in = port_in(spi->miso_port);
+    }
+
+    transfer_complete(dev);
+    transfer_check_schedule(dev, len, do_output);
 }
 
-void spi_master_deinit(
-        spi_master_t *spi)
+/*
+ * Outputs the SCLK cycles for one to four bytes. Each SCLK port word
+ * carries 16 SCLK cycles.
+ */
+__attribute__((always_inline))
+static inline void sclk_out_bytes(
+        spi_master_device_t *dev,
+        size_t bytes)
 {
-    port_disable(spi->cs_port);
-    if (spi->mosi_port != 0) {
-        port_disable(spi->mosi_port);
+    spi_master_t *spi = dev->spi_master_ctx;
+
+    if (bytes >= 2) {
+        port_out(spi->sclk_port, dev->clock_bits);
     }
-    if (spi->miso_port != 0) {
-        port_disable(spi->miso_port);
+    if (bytes == 4) {
+        port_out(spi->sclk_port, dev->clock_bits);
+    } else if (bytes & 1) {
+        spi_io_port_outpw(spi->sclk_port, dev->clock_bits, 16);
     }
-    port_disable(spi->sclk_port);
-    clock_disable(spi->clock_block);
 }
 
-void spi_master_device_init(
-        spi_master_device_t *dev,
+/*
+ * Outputs the next 32 bits on a MOSI port clocked by SCLK. With preset
+ * set the stream is one bit ahead of the data, as its first bit has
+ * already been driven, so the top bit of the following byte is shifted in.
+ */
+__attribute__((always_inline))
+static inline void mosi_out_word(
         spi_master_t *spi,
-        uint32_t cs_pin,
-        int cpol,
-        int cpha,
-        spi_master_source_clock_t source_clock,
-        uint32_t clock_divisor,
-        spi_master_sample_delay_t miso_sample_delay,
-        uint32_t miso_pad_delay,
-        uint32_t cs_to_clk_delay_ticks,
-        uint32_t clk_to_cs_delay_ticks,
-        uint32_t cs_to_cs_delay_ticks)
+        const uint8_t *data_out,
+        const uint32_t preset)
 {
-    dev->spi_master_ctx = spi;
-
-    dev->source_clock = source_clock;
-    dev->clock_divisor = clock_divisor;
-    dev->miso_sample_delay = miso_sample_delay;
-
-    dev->miso_initial_trigger_delay = (miso_sample_delay + 1) >> 1;
-    dev->miso_pad_delay = miso_pad_delay;
-
-    dev->cs_assert_val = 0xFFFFFFFF & ~(1 << cs_pin);
-    dev->clock_delay = cpha ? 0 : 1;
-    dev->clock_bits = cpol ? 0xAAAAAAAA : 0x55555555;
+    uint32_t word;
 
-    dev->cs_to_clk_delay_ticks = cs_to_clk_delay_ticks;
-    dev->clk_to_cs_delay_ticks = clk_to_cs_delay_ticks;
-    dev->cs_to_cs_delay_ticks = cs_to_cs_delay_ticks;
+    word = ((uint32_t)data_out[0] << 24) | ((uint32_t)data_out[1] << 16) |
+           ((uint32_t)data_out[2] << 8) | data_out[3];
+    if (preset) {
+        word = (word << 1) | (data_out[4] >> 7);
+    }
+    port_out(spi->mosi_port, bitrev(word));
 }
 
-void spi_master_init(
+/* As mosi_out_word() for the last one to four bytes of a transfer */
+__attribute__((always_inline))
+static inline void mosi_out_last(
         spi_master_t *spi,
-        xclock_t clock_block,
-        port_t cs_port,
-        port_t sclk_port,
-        port_t mosi_port,
-        port_t miso_port)
+        const uint8_t *data_out,
+        size_t bytes,
+        const uint32_t preset)
 {
-    /* Setup the clock block */
-    spi->clock_block = clock_block;
-    clock_enable(spi->clock_block);
+    uint32_t word = 0;
+    size_t i;
 
-    /* Setup the chip select port */
+    for (i = 0; i < bytes; i++) {
+        word |= (uint32_t)data_out[i] << (24 - 8 * i);
+    }
+    word <<= preset;
+    if (bytes == 4 && !preset) {
+        port_out(spi->mosi_port, bitrev(word));
+    } else {
+        spi_io_port_outpw(spi->mosi_port, bitrev(word), 8 * bytes - preset);
+    }
+}
+
+/*
+ * Saves one to four bytes input from a MISO port clocked by SCLK. A
+ * partial word is shifted into the top of the port's shift register.
+ */
+__attribute__((always_inline))
+static inline void miso_save_bytes(
+        uint8_t *data_in,
+        uint32_t word,
+        size_t bytes)
+{
+    size_t i;
+
+    word = bitrev(word) << (32 - 8 * bytes);
+    for (i = 0; i < bytes; i++) {
+        data_in[i] = word >> (24 - 8 * i);
+    }
+}
+
+/*
+ * The body of spi_master_transfer() for an interface initialized with
+ * spi_master_init_sclk_clocked(). MOSI and MISO only move on SCLK edges,
+ * so they need no trigger times. MOSI is kept one word ahead of SCLK and
+ * MISO is read one word behind it.
+ */
+__attribute__((always_inline))
+static inline void transfer_kernel_sclk_clocked(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len,
+        const int do_output,
+        const int do_input)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    /*
+     * With CPHA 0 the first bit must be valid before the leading edge,
+     * but the port only changes its output after the first edge, so the
+     * first bit is driven from the reference clock beforehand.
+     */
+    const uint32_t preset = do_output && dev->clock_delay;
+    size_t last;
+    size_t last_bytes;
+    size_t i;
+    uint32_t word;
+
+    if (len == 0) {
+        return;
+    }
+
+    last = (len - 1) / 4;
+    last_bytes = len - 4 * last;
+
+    transfer_wait_cs(spi);
+
+    if (preset) {
+        port_set_clock(spi->mosi_port, XS1_CLKBLK_REF);
+        spi_io_port_outpw(spi->mosi_port, data_out[0] >> 7, 1);
+        port_sync(spi->mosi_port);
+        port_set_clock(spi->mosi_port, spi->data_clock_block);
+    }
+    if (do_input && last == 0 && last_bytes < 4) {
+        port_set_shift_count(spi->miso_port, 8 * last_bytes);
+    }
+
+    if (do_output) {
+        if (last == 0) {
+            mosi_out_last(spi, data_out, last_bytes, preset);
+        } else {
+            mosi_out_word(spi, data_out, preset);
+        }
+    }
+    sclk_out_bytes(dev, last == 0 ? last_bytes : 4);
+    clock_start(spi->clock_block);
+
+    for (i = 1; i < last; i++) {
+        if (do_output) {
+            mosi_out_word(spi, data_out + 4 * i, preset);
+        }
+        sclk_out_bytes(dev, 4);
+        if (do_input) {
+            word = port_in(spi->miso_port);
+            miso_save_bytes(data_in + 4 * (i - 1), word, 4);
+        }
+    }
+
+    if (last > 0) {
+        if (do_output) {
+            mosi_out_last(spi, data_out + 4 * last, last_bytes, preset);
+        }
+        sclk_out_bytes(dev, last_bytes);
+        if (do_input) {
+            word = port_in(spi->miso_port);
+            if (last_bytes < 4) {
+                port_set_shift_count(spi->miso_port, 8 * last_bytes);
+            }
+            miso_save_bytes(data_in + 4 * (last - 1), word, 4);
+        }
+    }
+
+    if (do_input) {
+        word = port_in(spi->miso_port);
+        miso_save_bytes(data_in + 4 * last, word, last_bytes);
+    }
+
+    transfer_complete(dev);
+}
+
+static void transfer_sclk_clocked(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len,
+        const int do_output,
+        const int do_input)
+{
+    if (do_output && do_input) {
+        transfer_kernel_sclk_clocked(dev, data_out, data_in, len, 1, 1);
+    } else if (do_output) {
+        transfer_kernel_sclk_clocked(dev, data_out, NULL, len, 1, 0);
+    } else if (do_input) {
+        transfer_kernel_sclk_clocked(dev, NULL, data_in, len, 0, 1);
+    } else {
+        transfer_kernel_sclk_clocked(dev, NULL, NULL, len, 0, 0);
+    }
+}
+
+void spi_master_transfer(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    const int do_output = data_out != NULL && spi->mosi_port != 0;
+    const int do_input = data_in != NULL && spi->miso_port != 0;
+
+    if (spi->data_clock_block != 0) {
+        transfer_sclk_clocked(dev, data_out, data_in, len, do_output, do_input);
+        return;
+    }
+
+    if (do_input && spi->rx_drain != 0) {
+        if (do_output) {
+            transfer_kernel_rx_drain(dev, data_out, data_in, len, 1);
+        } else {
+            transfer_kernel_rx_drain(dev, NULL, data_in, len, 0);
+        }
+        return;
+    }
+
+    /*
+     * Select a kernel specialised for the transfer direction, so the
+     * per-word loop only contains the port operations it needs.
+     */
+    if (do_output && do_input) {
+        transfer_kernel(dev, data_out, data_in, len, NULL, 1, 1);
+    } else if (do_output) {
+        transfer_kernel(dev, data_out, NULL, len, NULL, 1, 0);
+    } else if (do_input) {
+        transfer_kernel(dev, NULL, data_in, len, NULL, 0, 1);
+    } else {
+        transfer_kernel(dev, NULL, NULL, len, NULL, 0, 0);
+    }
+}
+
+void spi_master_rx_drain_run(
+        port_t miso_port,
+        chanend_t c)
+{
+    uint8_t *data_in;
+
+    while ((data_in = (uint8_t *) s_chan_in_word(c)) != NULL) {
+        size_t len = s_chan_in_word(c);
+        uint32_t word_count = len / sizeof(uint16_t);
+        uint32_t remainder = len & sizeof(uint16_t) - 1;
+        uint32_t word;
+
+        if (word_count > 0) {
+            while (word_count-- != 1) {
+                word = port_in(miso_port);
+                save_data_in(data_in, word, 2);
+                data_in += 2;
+            }
+
+            if (remainder > 0) {
+                word = port_in(miso_port);
+                port_set_shift_count(miso_port, 16);
+                save_data_in(data_in, word, 2);
+                data_in += 2;
+            }
+        }
+
+        word = port_in(miso_port);
+        save_data_in(data_in, word, remainder);
+
+        s_chan_out_word(c, 0);
+    }
+}
+
+void spi_master_set_rx_drain(
+        spi_master_t *spi,
+        chanend_t c)
+{
+    if (spi->rx_drain != 0) {
+        s_chan_out_word(spi->rx_drain, (uint32_t) NULL);
+    }
+    spi->rx_drain = c;
+}
+
+static void expand_data_out(
+        uint32_t *words_out,
+        const uint8_t *data_out,
+        size_t len)
+{
+    size_t words = len / sizeof(uint16_t);
+
+    size_t i = 0;
+    for (; i + 1 < words; i += 2) {
+        words_out[i] = load_data_out(&data_out[2 * i], 2);
+        words_out[i + 1] = load_data_out(&data_out[2 * i + 2], 2);
+    }
+    if (i < words) {
+        words_out[i] = load_data_out(&data_out[2 * i], 2);
+        i++;
+    }
+    if (len & 1) {
+        words_out[i] = load_data_out(&data_out[2 * i], 1);
+    }
+}
+
+static void compact_data_in(
+        uint8_t *data_in,
+        const uint32_t *words_in,
+        size_t len)
+{
+    size_t words = len / sizeof(uint16_t);
+
+    size_t i = 0;
+    for (; i + 1 < words; i += 2) {
+        save_data_in(&data_in[2 * i], words_in[i], 2);
+        save_data_in(&data_in[2 * i + 2], words_in[i + 1], 2);
+    }
+    if (i < words) {
+        save_data_in(&data_in[2 * i], words_in[i], 2);
+        i++;
+    }
+    if (len & 1) {
+        save_data_in(&data_in[2 * i], words_in[i], 1);
+    }
+}
+
+void spi_master_transfer_expanded(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len,
+        uint32_t *words)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    const int do_output = data_out != NULL && spi->mosi_port != 0;
+    const int do_input = data_in != NULL && spi->miso_port != 0;
+
+    if (spi->data_clock_block != 0) {
+        /* The SCLK clocked ports take data bits unexpanded, so there is nothing to gain */
+        transfer_sclk_clocked(dev, data_out, data_in, len, do_output, do_input);
+        return;
+    }
+
+    if (do_output) {
+        expand_data_out(words, data_out, len);
+    }
+
+    if (do_output && do_input) {
+        transfer_kernel_expanded(dev, words, words, len, 1, 1);
+    } else if (do_output) {
+        transfer_kernel_expanded(dev, words, NULL, len, 1, 0);
+    } else if (do_input) {
+        transfer_kernel_expanded(dev, NULL, words, len, 0, 1);
+    } else {
+        transfer_kernel_expanded(dev, NULL, NULL, len, 0, 0);
+    }
+
+    if (do_input) {
+        compact_data_in(data_in, words, len);
+    }
+}
+
+void spi_master_transfer_crc(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len,
+        spi_crc_t *crc)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    const int do_output = data_out != NULL && spi->mosi_port != 0;
+    const int do_input = data_in != NULL && spi->miso_port != 0;
+
+    if (spi->data_clock_block != 0) {
+        /*
+         * The SCLK clocked kernel moves four bytes per port operation, which
+         * leaves no time to update the CRC as they go, so do it afterwards.
+         */
+        transfer_sclk_clocked(dev, data_out, data_in, len, do_output, do_input);
+        if (do_output) {
+            crc_update_buffer(&crc->tx, data_out, len, crc->poly);
+        }
+        if (do_input) {
+            crc_update_buffer(&crc->rx, data_in, len, crc->poly);
+        }
+        return;
+    }
+
+    /* Not specialised by direction, to limit code size */
+    transfer_kernel(dev, data_out, data_in, len, crc, do_output, do_input);
+}
+
+void spi_master_set_clock_backoff(
+        spi_master_device_t *dev,
+        uint32_t retry_transfers)
+{
+    dev->clock_backoff_retry = retry_transfers;
+    dev->clock_backoff_count = 0;
+}
+
+uint32_t spi_master_timing_error_count(
+        const spi_master_device_t *dev)
+{
+    return dev->timing_error_count;
+}
+
+void spi_master_set_realtime(
+        spi_master_t *spi,
+        int enable)
+{
+    spi->realtime = enable;
+}
+
+spi_master_lateness_t spi_master_lateness(
+        const spi_master_t *spi)
+{
+    spi_master_lateness_t lateness;
+
+    lateness.cs_ticks = spi->cs_late_max;
+    lateness.sclk_ticks = spi->sclk_late_max;
+    return lateness;
+}
+
+void spi_master_reset_lateness(
+        spi_master_t *spi)
+{
+    spi->cs_late_max = 0;
+    spi->sclk_late_max = 0;
+}
+
+uint32_t spi_master_current_clock_divisor(
+        const spi_master_device_t *dev)
+{
+    return dev->clock_divisor;
+}
+
+void spi_crc_init(
+        spi_crc_t *crc,
+        uint32_t poly,
+        uint32_t width,
+        uint32_t init)
+{
+    /* The crc instructions implement a reflected CRC, so reflect the parameters */
+    crc->width = width;
+    crc->poly = bitrev(poly) >> (32 - width);
+    crc->tx = bitrev(init) >> (32 - width);
+    crc->rx = crc->tx;
+}
+
+uint32_t spi_crc_tx_result(
+        const spi_crc_t *crc)
+{
+    return bitrev(crc->tx) >> (32 - crc->width);
+}
+
+uint32_t spi_crc_rx_result(
+        const spi_crc_t *crc)
+{
+    return bitrev(crc->rx) >> (32 - crc->width);
+}
+
+/*
+ * Returns the duration of one 32-bit port word (16 SCLK periods) in
+ * reference clock ticks as a Q16.16 value, so that the schedule of a
+ * long transfer does not drift when SCLK is derived from the core clock.
+ */
+static uint32_t port_word_ticks_q16(
+        const spi_master_device_t *dev)
+{
+    uint64_t ticks_q16;
+
+    ticks_q16 = (uint64_t)32 * (dev->clock_divisor ? 2 * dev->clock_divisor : 1) << 16;
+    if (dev->source_clock == spi_master_source_clock_xcore) {
+        ticks_q16 = ticks_q16 * PLATFORM_REFERENCE_MHZ / PLATFORM_NODE_0_SYSTEM_FREQUENCY_MHZ;
+    }
+
+    return (uint32_t)ticks_q16;
+}
+
+static inline int port_word_due(
+        const spi_master_transfer_state_t *xfer,
+        uint32_t word_index,
+        uint32_t now)
+{
+    uint32_t due_time = xfer->start_time + (uint32_t)(((uint64_t)word_index * xfer->word_ticks_q16) >> 16);
+
+    return !timeafter(due_time, now);
+}
+
+void spi_master_transfer_start(
+        spi_master_device_t *dev,
+        uint8_t *data_out,
+        uint8_t *data_in,
+        size_t len)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    spi_master_transfer_state_t *xfer = &spi->xfer;
+
+    xfer->do_output = data_out != NULL && spi->mosi_port != 0;
+    xfer->do_input = data_in != NULL && spi->miso_port != 0;
+
+    if (spi->data_clock_block != 0) {
+        /*
+         * The port words are scheduled below by the SCLK rate of clock_block,
+         * which does not hold for ports clocked by SCLK, so complete the
+         * transfer now and leave nothing for poll or wait to do.
+         */
+        transfer_sclk_clocked(dev, data_out, data_in, len, xfer->do_output, xfer->do_input);
+        xfer->active = 0;
+        return;
+    }
+
+    xfer->active = len != 0;
+
+    if (len == 0) {
+        return;
+    }
+
+    xfer->remainder = len & sizeof(uint16_t) - 1;
+    xfer->word_count = len / sizeof(uint16_t) + xfer->remainder;
+    xfer->word_ticks_q16 = port_word_ticks_q16(dev);
+
+    transfer_begin(dev, xfer->do_output ? load_data_out(data_out, len) : 0, len, xfer->do_output, xfer->do_input);
+    xfer->start_time = get_reference_time();
+
+    xfer->data_out = data_out + 2;
+    xfer->data_in = data_in;
+    xfer->next_out = 1;
+    /* With no MISO there is nothing to read back, only the end to wait for */
+    xfer->next_in = xfer->do_input ? 0 : xfer->word_count;
+}
+
+/*
+ * Outputs the next port word. This must happen before the previous
+ * word has been shifted out, so it becomes due as soon as that word
+ * has been moved into the shift register.
+ */
+static inline void transfer_output_next(
+        spi_master_device_t *dev,
+        spi_master_transfer_state_t *xfer)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    const int last_is_partial = xfer->remainder && xfer->next_out == xfer->word_count - 1;
+
+    if (last_is_partial) {
+        spi_io_port_outpw(spi->sclk_port, dev->clock_bits, 16);
+        if (xfer->do_output) {
+            spi_io_port_outpw(spi->mosi_port, load_data_out(xfer->data_out, 1), 16);
+        }
+    } else {
+        port_out(spi->sclk_port, dev->clock_bits);
+        if (xfer->do_output) {
+            port_out(spi->mosi_port, load_data_out(xfer->data_out, 2));
+        }
+    }
+    xfer->data_out += 2;
+    xfer->next_out++;
+}
+
+/*
+ * Inputs the next port word, which becomes due once it has been
+ * completely shifted in.
+ */
+static inline void transfer_input_next(
+        spi_master_device_t *dev,
+        spi_master_transfer_state_t *xfer)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    const int is_last = xfer->next_in == xfer->word_count - 1;
+    uint32_t word;
+
+    word = port_in(spi->miso_port);
+    if (xfer->remainder && xfer->next_in == xfer->word_count - 2) {
+        /* The final port word only carries one byte */
+        port_set_shift_count(spi->miso_port, 16);
+    }
+    save_data_in(xfer->data_in, word, is_last ? xfer->remainder : 2);
+    xfer->data_in += 2;
+    xfer->next_in++;
+}
+
+static void transfer_end(
+        spi_master_device_t *dev)
+{
+    spi_master_t *spi = dev->spi_master_ctx;
+    spi_master_transfer_state_t *xfer = &spi->xfer;
+
+    transfer_complete(dev);
+    /* A poll which came too late to keep the ports fed shows up here */
+    transfer_check_schedule(dev, 2 * xfer->word_count - xfer->remainder, xfer->do_output);
+    xfer->active = 0;
+}
+
+int spi_master_transfer_poll(
+        spi_master_device_t *dev)
+{
+    spi_master_transfer_state_t *xfer = &dev->spi_master_ctx->xfer;
+    uint32_t now;
+
+    if (!xfer->active) {
+        return 1;
+    }
+
+    now = get_reference_time();
+
+    if (xfer->next_out < xfer->word_count && port_word_due(xfer, xfer->next_out - 1, now)) {
+        transfer_output_next(dev, xfer);
+    }
+    if (xfer->next_in < xfer->word_count && port_word_due(xfer, xfer->next_in + 1, now)) {
+        transfer_input_next(dev, xfer);
+    }
+    if (xfer->next_out == xfer->word_count &&
+        xfer->next_in == xfer->word_count &&
+        port_word_due(xfer, xfer->word_count, now)) {
+        transfer_end(dev);
+        return 1;
+    }
+
+    return 0;
+}
+
+void spi_master_transfer_wait(
+        spi_master_device_t *dev)
+{
+    spi_master_transfer_state_t *xfer = &dev->spi_master_ctx->xfer;
+
+    if (!xfer->active) {
+        return;
+    }
+
+    /* The port operations themselves block until each word is due */
+    while (xfer->next_out < xfer->word_count) {
+        transfer_output_next(dev, xfer);
+        if (xfer->next_in < xfer->next_out - 1) {
+            transfer_input_next(dev, xfer);
+        }
+    }
+    while (xfer->next_in < xfer->word_count) {
+        transfer_input_next(dev, xfer);
+    }
+
+    transfer_end(dev);
+}
+
+void spi_master_end_transaction(
+        spi_master_device_t *dev)
+{
+    const uint32_t cs_deassert_val = 0xFFFFFFFF;
+    spi_master_t *spi = dev->spi_master_ctx;
+    const uint32_t now = get_reference_time();
+    uint32_t scheduled;
+    uint32_t deasserted;
+
+    port_sync(spi->cs_port);
+    scheduled = port_get_trigger_time(spi->cs_port);
+
+    /*
+     * Deassert CS now, and again scheduled for the earliest
+     * time CS is allowed to be re-asserted. The next transaction
+     * will sync on CS before starting to ensure the minimum
+     * CS to CS time is met.
+     */
+    deasserted = spi_master_schedule_cs(spi, cs_deassert_val, dev->cs_to_cs_delay_ticks);
+
+    /*
+     * After a transfer, and unless another delay has been scheduled since,
+     * the last CS output was scheduled for the end of the clock to CS delay.
+     * If that had already passed when this was called the deassert could
+     * not have gone out on time, so it is not an edge that was late.
+     */
+    if (!spi->delay_before_transfer && !timeafter(now, spi->cs_due_time)) {
+        uint32_t late = (uint16_t)(deasserted - scheduled);
+        if (late > spi->cs_late_max) {
+            spi->cs_late_max = late;
+        }
+    }
+
+    if (spi->realtime) {
+        spi_master_realtime_exit(spi->saved_thread_mode);
+    }
+}
+
+void spi_master_deinit(
+        spi_master_t *spi)
+{
+    port_disable(spi->cs_port);
+    if (spi->mosi_port != 0) {
+        port_disable(spi->mosi_port);
+    }
+    if (spi->miso_port != 0) {
+        port_disable(spi->miso_port);
+    }
+    port_disable(spi->sclk_port);
+    clock_disable(spi->clock_block);
+    if (spi->data_clock_block != 0) {
+        clock_disable(spi->data_clock_block);
+    }
+}
+
+void spi_master_device_init(
+        spi_master_device_t *dev,
+        spi_master_t *spi,
+        uint32_t cs_pin,
+        int cpol,
+        int cpha,
+        spi_master_source_clock_t source_clock,
+        uint32_t clock_divisor,
+        spi_master_sample_delay_t miso_sample_delay,
+        uint32_t miso_pad_delay,
+        uint32_t cs_to_clk_delay_ticks,
+        uint32_t clk_to_cs_delay_ticks,
+        uint32_t cs_to_cs_delay_ticks)
+{
+    dev->spi_master_ctx = spi;
+
+    dev->source_clock = source_clock;
+    dev->clock_divisor = clock_divisor;
+    dev->nominal_clock_divisor = clock_divisor;
+    dev->timing_error_count = 0;
+    spi_master_set_clock_backoff(dev, SPI_MASTER_CLOCK_BACKOFF_RETRY);
+    dev->miso_sample_delay = miso_sample_delay;
+
+    dev->miso_initial_trigger_delay = (miso_sample_delay + 1) >> 1;
+    dev->miso_pad_delay = miso_pad_delay;
+
+    dev->cs_assert_val = 0xFFFFFFFF & ~(1 << cs_pin);
+    if (dev->cs_assert_val == spi->current_device) {
+        /* The clock block and ports are still set up for the old settings */
+        spi->current_device_stale = 1;
+    }
+    dev->clock_delay = cpha ? 0 : 1;
+
+    if (spi->data_clock_block != 0) {
+        /*
+         * The data ports are clocked by SCLK before the port inversion.
+         * This must idle low with CPHA 0 and high with CPHA 1, so that
+         * MOSI changes on the trailing and leading edges respectively,
+         * and the inversion then gives the idle level set by CPOL.
+         */
+        dev->clock_bits = cpha ? 0xAAAAAAAA : 0x55555555;
+        dev->sclk_invert = cpol ^ cpha;
+    } else {
+        dev->clock_bits = cpol ? 0xAAAAAAAA : 0x55555555;
+        dev->sclk_invert = 0;
+    }
+
+    dev->cs_to_clk_delay_ticks = cs_to_clk_delay_ticks;
+    dev->clk_to_cs_delay_ticks = clk_to_cs_delay_ticks;
+    dev->cs_to_cs_delay_ticks = cs_to_cs_delay_ticks;
+}
+
+int spi_master_broadcast_init(
+        spi_master_device_t *group,
+        spi_master_device_t *const *members,
+        size_t num_members)
+{
+    const spi_master_device_t *first;
+    size_t i;
+
+    xassert(num_members > 0);
+    first = members[0];
+
+    for (i = 1; i < num_members; i++) {
+        const spi_master_device_t *dev = members[i];
+        if (dev->spi_master_ctx != first->spi_master_ctx ||
+            dev->source_clock != first->source_clock ||
+            dev->nominal_clock_divisor != first->nominal_clock_divisor ||
+            dev->clock_delay != first->clock_delay ||
+            dev->clock_bits != first->clock_bits ||
+            dev->sclk_invert != first->sclk_invert) {
+            return 0;
+        }
+    }
+
+    *group = *first;
+    group->clock_divisor = group->nominal_clock_divisor;
+    group->timing_error_count = 0;
+    group->clock_backoff_count = 0;
+
+    for (i = 1; i < num_members; i++) {
+        const spi_master_device_t *dev = members[i];
+        group->cs_assert_val &= dev->cs_assert_val;
+        if (dev->cs_to_clk_delay_ticks > group->cs_to_clk_delay_ticks) {
+            group->cs_to_clk_delay_ticks = dev->cs_to_clk_delay_ticks;
+        }
+        if (dev->clk_to_cs_delay_ticks > group->clk_to_cs_delay_ticks) {
+            group->clk_to_cs_delay_ticks = dev->clk_to_cs_delay_ticks;
+        }
+        if (dev->cs_to_cs_delay_ticks > group->cs_to_cs_delay_ticks) {
+            group->cs_to_cs_delay_ticks = dev->cs_to_cs_delay_ticks;
+        }
+    }
+
+    return 1;
+}
+
+void spi_master_broadcast_write(
+        spi_master_device_t *group,
+        uint8_t *data_out,
+        size_t len)
+{
+    spi_master_start_transaction(group);
+    spi_master_transfer(group, data_out, NULL, len);
+    spi_master_end_transaction(group);
+}
+
+void spi_master_init(
+        spi_master_t *spi,
+        xclock_t clock_block,
+        port_t cs_port,
+        port_t sclk_port,
+        port_t mosi_port,
+        port_t miso_port)
+{
+    /* Setup the clock block */
+    spi->clock_block = clock_block;
+    spi->data_clock_block = 0;
+    clock_enable(spi->clock_block);
+
+    /* Setup the chip select port */
     spi->cs_port = cs_port;
     port_enable(spi->cs_port);
     port_set_clock(spi->cs_port, XS1_CLKBLK_REF);
     port_out(spi->cs_port, 0xFFFFFFFF);
     port_sync(spi->cs_port);
     spi->current_device = 0xFFFFFFFF;
+    spi->current_device_stale = 0;
+    spi->rx_drain = 0;
+    spi->realtime = SPI_MASTER_REALTIME;
+    spi->saved_thread_mode = 0;
+    spi_master_reset_lateness(spi);
 
     /* Setup the SCLK port */
     spi->sclk_port = sclk_port;
@@ -309,3 +1363,31 @@ void spi_master_init(
         port_clear_buffer(spi->miso_port);
     }
 }
+
+void spi_master_init_sclk_clocked(
+        spi_master_t *spi,
+        xclock_t clock_block,
+        xclock_t data_clock_block,
+        port_t cs_port,
+        port_t sclk_port,
+        port_t mosi_port,
+        port_t miso_port)
+{
+    spi_master_init(spi, clock_block, cs_port, sclk_port, mosi_port, miso_port);
+
+    /* Setup the data clock block to be driven by the SCLK pin */
+    spi->data_clock_block = data_clock_block;
+    clock_enable(spi->data_clock_block);
+    clock_set_source_port(spi->data_clock_block, spi->sclk_port);
+
+    if (mosi_port != 0) {
+        port_set_clock(spi->mosi_port, spi->data_clock_block);
+        port_clear_buffer(spi->mosi_port);
+    }
+    if (miso_port != 0) {
+        port_set_clock(spi->miso_port, spi->data_clock_block);
+        port_clear_buffer(spi->miso_port);
+    }
+
+    clock_start(spi->data_clock_block);
+}
@@ -0,0 +1,104 @@
+// Copyright 2025 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <stdint.h>
+#include "spi_fwk.h"
+#include <xcore/channel_streaming.h>
+
+void spi_master_capture_init(
+        spi_master_capture_t *capture,
+        spi_master_device_t *dev,
+        uint8_t *buffer_0,
+        uint8_t *buffer_1,
+        size_t buffer_len,
+        size_t sample_len)
+{
+    capture->dev = dev;
+    capture->buffer[0] = buffer_0;
+    capture->buffer[1] = buffer_1;
+    capture->buffer_len = buffer_len;
+    capture->sample_len = sample_len;
+    capture->buffer_busy[0] = 0;
+    capture->buffer_busy[1] = 0;
+    capture->stop = 0;
+    capture->buffers_captured = 0;
+    capture->overruns = 0;
+}
+
+static void capture_fill(
+        spi_master_capture_t *capture,
+        uint8_t *buffer)
+{
+    spi_master_device_t *dev = capture->dev;
+    size_t offset;
+
+    if (capture->sample_len == 0) {
+        spi_master_transfer(dev, NULL, buffer, capture->buffer_len);
+        return;
+    }
+
+    for (offset = 0; offset < capture->buffer_len; offset += capture->sample_len) {
+        spi_master_start_transaction(dev);
+        spi_master_transfer(dev, NULL, buffer + offset, capture->sample_len);
+        spi_master_end_transaction(dev);
+    }
+}
+
+void spi_master_capture_run(
+        spi_master_capture_t *capture,
+        chanend_t c_consumer)
+{
+    int current = 0;
+
+    if (capture->sample_len == 0) {
+        spi_master_start_transaction(capture->dev);
+    }
+
+    while (!capture->stop) {
+        capture_fill(capture, capture->buffer[current]);
+        capture->buffers_captured++;
+
+        if (capture->buffer_busy[current ^ 1]) {
+            /*
+             * The consumer still holds the other buffer, so this
+             * one is captured into again and its samples are lost.
+             */
+            capture->overruns++;
+        } else {
+            /* Mark the buffer busy first, as the consumer may release it straight away */
+            capture->buffer_busy[current] = 1;
+            s_chan_out_word(c_consumer, (uint32_t)capture->buffer[current]);
+            current ^= 1;
+        }
+    }
+
+    if (capture->sample_len == 0) {
+        spi_master_end_transaction(capture->dev);
+    }
+
+    s_chan_out_word(c_consumer, (uint32_t)NULL);
+}
+
+void spi_master_capture_release(
+        spi_master_capture_t *capture,
+        uint8_t *buffer)
+{
+    capture->buffer_busy[buffer == capture->buffer[1]] = 0;
+}
+
+void spi_master_capture_stop(
+        spi_master_capture_t *capture)
+{
+    capture->stop = 1;
+}
+
+uint32_t spi_master_capture_buffer_count(
+        const spi_master_capture_t *capture)
+{
+    return capture->buffers_captured;
+}
+
+uint32_t spi_master_capture_overrun_count(
+        const spi_master_capture_t *capture)
+{
+    return capture->overruns;
+}
@@ -0,0 +1,93 @@
+// Copyright 2025 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <stdint.h>
+#include <string.h>
+#include "spi_fwk.h"
+
+/*
+ * The frame is kept in the order it is sent, so the links are stored last
+ * first and an update is a single transfer of the whole frame. The data
+ * returned comes out of the chain in the same order, so each link's data
+ * in is at the same offset as its data out.
+ */
+
+static size_t link_offset(
+        const spi_master_daisy_chain_t *chain,
+        size_t link)
+{
+    size_t offset = 0;
+    size_t i;
+
+    for (i = link + 1; i < chain->num_links; i++) {
+        offset += chain->link_bytes[i];
+    }
+    return offset;
+}
+
+void spi_master_daisy_chain_init(
+        spi_master_daisy_chain_t *chain,
+        spi_master_device_t *dev,
+        const size_t *link_bytes,
+        size_t num_links,
+        uint8_t *frame,
+        uint8_t *frame_in)
+{
+    size_t i;
+
+    chain->dev = dev;
+    chain->link_bytes = link_bytes;
+    chain->num_links = num_links;
+    chain->frame = frame;
+    chain->frame_in = frame_in;
+    chain->frame_len = 0;
+    for (i = 0; i < num_links; i++) {
+        chain->frame_len += link_bytes[i];
+    }
+
+    memset(frame, 0, chain->frame_len);
+    if (frame_in != NULL) {
+        memset(frame_in, 0, chain->frame_len);
+    }
+}
+
+uint8_t *spi_master_daisy_chain_link(
+        spi_master_daisy_chain_t *chain,
+        size_t link)
+{
+    return &chain->frame[link_offset(chain, link)];
+}
+
+const uint8_t *spi_master_daisy_chain_link_in(
+        const spi_master_daisy_chain_t *chain,
+        size_t link)
+{
+    if (chain->frame_in == NULL) {
+        return NULL;
+    }
+    return &chain->frame_in[link_offset(chain, link)];
+}
+
+void spi_master_daisy_chain_set(
+        spi_master_daisy_chain_t *chain,
+        size_t link,
+        const uint8_t *data)
+{
+    memcpy(spi_master_daisy_chain_link(chain, link), data, chain->link_bytes[link]);
+}
+
+void spi_master_daisy_chain_update(
+        spi_master_daisy_chain_t *chain)
+{
+    spi_master_start_transaction(chain->dev);
+    spi_master_transfer(chain->dev, chain->frame, chain->frame_in, chain->frame_len);
+    spi_master_end_transaction(chain->dev);
+}
+
+void spi_master_daisy_chain_write(
+        spi_master_daisy_chain_t *chain,
+        size_t link,
+        const uint8_t *data)
+{
+    spi_master_daisy_chain_set(chain, link, data);
+    spi_master_daisy_chain_update(chain);
+}
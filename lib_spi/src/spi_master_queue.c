@@ -0,0 +1,110 @@
+// Copyright 2025 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <stdint.h>
+#include "spi_fwk.h"
+#include <xcore/channel_streaming.h>
+
+/*
+ * There is no compare and swap instruction to build a multi-producer ring
+ * from, so each producer has a single-producer ring of its own which the
+ * worker polls. Head and tail are free running and only ever written by
+ * one side each, so no locks are needed.
+ */
+
+void spi_master_queue_init(
+        spi_master_queue_t *queue,
+        spi_master_queue_ring_t *rings,
+        size_t num_producers)
+{
+    size_t i;
+
+    for (i = 0; i < num_producers; i++) {
+        rings[i].head = 0;
+        rings[i].tail = 0;
+        rings[i].c_notify = 0;
+    }
+    queue->rings = rings;
+    queue->num_producers = num_producers;
+    queue->stop = 0;
+}
+
+void spi_master_queue_set_notify(
+        spi_master_queue_t *queue,
+        size_t producer,
+        chanend_t c_notify)
+{
+    queue->rings[producer].c_notify = c_notify;
+}
+
+int spi_master_queue_submit(
+        spi_master_queue_t *queue,
+        size_t producer,
+        spi_master_request_t *request)
+{
+    spi_master_queue_ring_t *ring = &queue->rings[producer];
+    uint32_t head = ring->head;
+
+    if (head - ring->tail == SPI_MASTER_QUEUE_DEPTH) {
+        return 0;
+    }
+
+    request->done = 0;
+    ring->slot[head & (SPI_MASTER_QUEUE_DEPTH - 1)] = request;
+    /* Publish the request only once its slot has been written */
+    ring->head = head + 1;
+
+    return 1;
+}
+
+int spi_master_request_done(
+        const spi_master_request_t *request)
+{
+    return request->done;
+}
+
+static void serve_request(
+        spi_master_request_t *request)
+{
+    spi_master_start_transaction(request->dev);
+    spi_master_transfer(request->dev, request->data_out, request->data_in, request->len);
+    spi_master_end_transaction(request->dev);
+    request->done = 1;
+}
+
+void spi_master_queue_run(
+        spi_master_queue_t *queue)
+{
+    size_t i;
+    int idle = 0;
+
+    while (!(idle && queue->stop)) {
+        idle = 1;
+        for (i = 0; i < queue->num_producers; i++) {
+            spi_master_queue_ring_t *ring = &queue->rings[i];
+            uint32_t tail = ring->tail;
+            uint32_t head = ring->head;
+            uint32_t completed;
+
+            if (tail == head) {
+                continue;
+            }
+            idle = 0;
+
+            /* Serve everything pending, then notify the producer once */
+            for (completed = 0; tail != head; completed++) {
+                serve_request(ring->slot[tail & (SPI_MASTER_QUEUE_DEPTH - 1)]);
+                tail++;
+                ring->tail = tail;
+            }
+            if (ring->c_notify != 0) {
+                s_chan_out_word(ring->c_notify, completed);
+            }
+        }
+    }
+}
+
+void spi_master_queue_stop(
+        spi_master_queue_t *queue)
+{
+    queue->stop = 1;
+}
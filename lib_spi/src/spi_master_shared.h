@@ -30,4 +30,9 @@ unsigned spi_master_get_actual_clock_rate(spi_master_source_clock_t source_clock
 
 // Find the best clock divider and source to hit the target rate. Note this will always round down to the next slowest available rate
 // effectively using a ceil type function
-void spi_master_determine_clock_settings(spi_master_source_clock_t *source_clock, unsigned *divider, unsigned speed_in_khz);
\ No newline at end of file
+void spi_master_determine_clock_settings(spi_master_source_clock_t *source_clock, unsigned *divider, unsigned speed_in_khz);
+
+// Set and restore the real-time mode bits of the calling thread, as spi_master_start_transaction()
+// and spi_master_end_transaction() do in real-time mode. Used by the clockblock-less spi_master().
+uint32_t spi_master_realtime_enter(void);
+void spi_master_realtime_exit(uint32_t saved);
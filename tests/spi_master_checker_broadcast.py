@@ -0,0 +1,62 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+import Pyxsim as px
+from functools import partial
+
+# We need to disable output buffering for this test to work on MacOS; this has
+# no effect on Linux systems. Let's redefine print once to avoid putting the
+# same argument everywhere.
+print = partial(print, flush=True)
+
+
+class SPIMasterBroadcastChecker(px.SimThread):
+    """"
+    This simulator thread will act as any number of SPI slaves sharing MOSI,
+    and print the chip selects asserted and the bytes received in each
+    transaction.
+    """
+    def __init__(self,
+                 sck_port: str,
+                 mosi_port: str,
+                 ss_port: str,
+                 spi_mode: int) -> None:
+        self._mosi_port = mosi_port
+        self._sck_port = sck_port
+        self._ss_port = ss_port
+        self._ss_port_width = px.pyxsim.xsi_get_port_width(ss_port.split(':')[1] if ":" in ss_port else ss_port)
+        self._cpol = spi_mode >> 1
+        self._cpha = spi_mode & 1
+
+    def run(self):
+        xsi: px.pyxsim.Xsi = self.xsi
+        ss_deasserted_value = (0xffffffff >> (32 - self._ss_port_width))
+
+        print("SPI Master broadcast checker started")
+
+        while True:
+            # Wait for any chip select to be asserted
+            ss_value = xsi.sample_port_pins(self._ss_port) & ss_deasserted_value
+            while ss_value == ss_deasserted_value:
+                self.wait_for_port_pins_change([self._ss_port])
+                ss_value = xsi.sample_port_pins(self._ss_port) & ss_deasserted_value
+            selected = ~ss_value & ss_deasserted_value
+
+            sck_value = xsi.sample_port_pins(self._sck_port)
+            bits = []
+            while True:
+                self.wait_for_port_pins_change([self._ss_port, self._sck_port])
+                if (xsi.sample_port_pins(self._ss_port) & ss_deasserted_value) != ss_value:
+                    break
+                new_sck_value = xsi.sample_port_pins(self._sck_port)
+                if new_sck_value == sck_value:
+                    continue
+                sck_value = new_sck_value
+                leading = sck_value != self._cpol
+                # Sample on the leading edge with CPHA 0 and the trailing edge with CPHA 1
+                if leading != bool(self._cpha):
+                    bits.append(xsi.sample_port_pins(self._mosi_port))
+
+            data = [int("".join(str(b) for b in bits[i:i + 8]), 2) for i in range(0, len(bits) - 7, 8)]
+            if len(bits) % 8:
+                print(f"Error: {len(bits)} bits received, not a whole number of bytes")
+            print(f"ss 0x{selected:x}: " + " ".join(f"{d:02x}" for d in data))
@@ -0,0 +1,35 @@
+// Copyright 2025 XMOS LIMITED.
+// This Software is subject to the terms of the XMOS Public Licence: Version 1.
+#include <xcore/thread.h>
+
+// Thread mode access for spi_master_realtime.xc, which cannot use lib_xcore
+
+unsigned test_thread_mode_get(void)
+{
+    return local_thread_mode_get_bits();
+}
+
+void test_thread_mode_set(unsigned bits)
+{
+    local_thread_mode_set_bits(bits);
+}
+
+void test_thread_mode_clear(unsigned bits)
+{
+    local_thread_mode_clear_bits(bits);
+}
+
+unsigned test_thread_mode_fast(void)
+{
+    return thread_mode_fast;
+}
+
+// The bits the SPI master sets in real-time mode
+unsigned test_thread_mode_realtime(void)
+{
+#if defined(__XS3A__)
+    return thread_mode_fast | thread_mode_high_priority;
+#else
+    return thread_mode_fast;
+#endif
+}
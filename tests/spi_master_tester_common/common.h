@@ -51,6 +51,16 @@ static void broadcast_settings(
     send_data_to_tester(setup_strobe_port, setup_data_port, num_bytes);
 }
 
+// Longest a transaction of num_bytes at speed_in_khz may take, in reference
+// clock ticks: twice its bit time plus an allowance for the CS delays and the
+// software around the transfer. A bus left running at an earlier, slower speed
+// takes longer than this.
+#define TRANSFER_TIME_ALLOWANCE_TICKS 2000
+
+static unsigned transfer_time_limit(unsigned num_bytes, unsigned speed_in_khz){
+    return 2 * num_bytes * 8 * XS1_TIMER_KHZ / speed_in_khz + TRANSFER_TIME_ALLOWANCE_TICKS;
+}
+
 #define NUMBER_OF_TEST_BYTES 16
 #define NUMBER_OF_TEST_WORDS (NUMBER_OF_TEST_BYTES/sizeof(uint32_t))
 
@@ -0,0 +1,161 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+import Pyxsim as px
+from functools import partial
+
+# We need to disable output buffering for this test to work on MacOS; this has
+# no effect on Linux systems. Let's redefine print once to avoid putting the
+# same argument everywhere.
+print = partial(print, flush=True)
+
+# Must match spi_slave_throughput_benchmark.xc
+BURST_BYTES = 512
+GAP_TRANSACTIONS = 8
+GAP_BYTES = 16
+
+def mosi_pattern(n):
+    return (n * 7 + 0x5a) & 0xff
+
+def miso_pattern(n):
+    return (n * 13 + 0x33) & 0xff
+
+
+class SPISlaveThroughputChecker(px.SimThread):
+    """"
+    This simulator thread will act as SPI master. It finds the fastest SCLK at
+    which the slave sustains a long burst, then the shortest slave select
+    deassert to assert gap at which it keeps up with back to back transactions.
+    The DUT reports the number of transactions it has seen and the number with
+    wrong MOSI data on the status port.
+    """
+    def __init__(self,
+                 sck_port: str,
+                 mosi_port: str,
+                 miso_port: str,
+                 ss_port: str,
+                 status_port: str,
+                 exit_port: str,
+                 spi_mode: int) -> None:
+        self._miso_port = miso_port
+        self._mosi_port = mosi_port
+        self._sck_port = sck_port
+        self._ss_port = ss_port
+        self._status_port = status_port
+        self._exit_port = exit_port
+        self._cpol = spi_mode >> 1
+        self._cpha = spi_mode & 1
+
+    def read_status(self):
+        status = self.xsi.sample_port_pins(self._status_port)
+        return status & 0xff, (status >> 8) & 0xff
+
+    def transaction(self, num_bytes, half_clock, clock_delay):
+        """Runs one transaction and returns the number of MISO bytes received wrongly"""
+        xsi: px.pyxsim.Xsi = self.xsi
+        errors = 0
+
+        xsi.drive_port_pins(self._sck_port, self._cpol)
+        xsi.drive_port_pins(self._ss_port, 0)
+        time_trigger = xsi.get_time() + clock_delay
+        self.wait_until(time_trigger)
+
+        clock_val = (self._cpol ^ self._cpha) & 1
+        for byte_count in range(num_bytes):
+            tx_byte = mosi_pattern(byte_count)
+            rx_byte = 0
+            for bit in range(8):
+                # clock edge and drive data out
+                xsi.drive_port_pins(self._sck_port, clock_val)
+                xsi.drive_port_pins(self._mosi_port, (tx_byte >> (7 - bit)) & 1)
+
+                time_trigger += half_clock
+                self.wait_until(time_trigger)
+
+                # clock edge and read data in
+                xsi.drive_port_pins(self._sck_port, 1 - clock_val)
+                rx_byte = (rx_byte << 1) + xsi.sample_port_pins(self._miso_port)
+
+                time_trigger += half_clock
+                self.wait_until(time_trigger)
+
+            if rx_byte != miso_pattern(byte_count):
+                errors += 1
+
+        time_trigger += half_clock
+        self.wait_until(time_trigger)
+
+        xsi.drive_port_pins(self._sck_port, self._cpol)
+        xsi.drive_port_pins(self._ss_port, 1)
+        return errors
+
+    def trial(self, num_transactions, num_bytes, kbps, clock_delay, gap):
+        """Runs back to back transactions and returns whether the slave kept up with all of them"""
+        half_clock = self._millisecond_ticks / (2 * kbps)
+        count_before, errors_before = self.read_status()
+        miso_errors = 0
+
+        for t in range(num_transactions):
+            if t:
+                self.wait_until(self.xsi.get_time() + gap)
+            miso_errors += self.transaction(num_bytes, half_clock, clock_delay)
+
+        # Let the slave finish the last transaction before checking what it saw
+        self.wait_until(self.xsi.get_time() + 50 * self._microsecond_ticks)
+        count_after, errors_after = self.read_status()
+        count = (count_after - count_before) & 0xff
+        mosi_errors = (errors_after - errors_before) & 0xff
+
+        return count == num_transactions and mosi_errors == 0 and miso_errors == 0
+
+    def run(self):
+        xsi: px.pyxsim.Xsi = self.xsi
+        xsi.drive_port_pins(self._exit_port, 0)
+        xsi.drive_port_pins(self._sck_port, self._cpol)
+        xsi.drive_port_pins(self._ss_port, 1)
+
+        print("SPI Slave throughput checker started")
+
+        # some timing constants
+        xsi_tick_freq_hz = float(1e15)
+        nanosecond_ticks = xsi_tick_freq_hz / 1e9
+        self._microsecond_ticks = xsi_tick_freq_hz / 1e6
+        self._millisecond_ticks = xsi_tick_freq_hz / 1e3
+
+        # A generous SS to clock delay, so that results do not depend on the
+        # time the slave takes to react to slave select (see spi_slave_benchmark)
+        clock_delay = 10 * self._microsecond_ticks
+
+        # Let the slave start up
+        self.wait_until(xsi.get_time() + 50 * self._microsecond_ticks)
+
+        # Fastest SCLK for a single long transaction, to a resolution of 100 kbps
+        kbps_pass = 0
+        kbps_fail = 100000
+        while kbps_fail - kbps_pass > 100:
+            kbps = (kbps_pass + kbps_fail) // 2
+            if self.trial(1, BURST_BYTES, kbps, clock_delay, 0):
+                kbps_pass = kbps
+            else:
+                kbps_fail = kbps
+
+        # Shortest gap between transactions to a resolution of 20 ns, clocked at
+        # half of the burst speed so that the gap is the only limit
+        gap_kbps = max(kbps_pass // 2, 100)
+        gap_pass_ns = 20000
+        gap_fail_ns = 0
+        if not self.trial(GAP_TRANSACTIONS, GAP_BYTES, gap_kbps, clock_delay, gap_pass_ns * nanosecond_ticks):
+            gap_pass_ns = 0
+        else:
+            while gap_pass_ns - gap_fail_ns > 20:
+                gap_ns = (gap_pass_ns + gap_fail_ns) // 2
+                if self.trial(GAP_TRANSACTIONS, GAP_BYTES, gap_kbps, clock_delay, gap_ns * nanosecond_ticks):
+                    gap_pass_ns = gap_ns
+                else:
+                    gap_fail_ns = gap_ns
+
+        if kbps_pass == 0 or gap_pass_ns == 0:
+            print("ERROR! Run did not find a workable setting")
+        else:
+            print(f"RESULT: {kbps_pass} {gap_kbps} {gap_pass_ns}")
+
+        xsi.drive_port_pins(self._exit_port, 1)
@@ -0,0 +1,95 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+import Pyxsim as px
+from functools import partial
+
+# We need to disable output buffering for this test to work on MacOS; this has
+# no effect on Linux systems. Let's redefine print once to avoid putting the
+# same argument everywhere.
+print = partial(print, flush=True)
+
+# Each transaction is the bytes sent on MOSI and the bytes expected on MISO,
+# with None for bytes which are not checked. The first byte is the address,
+# with the top bit set for a read. The register file starts with n * 3 at offset n.
+transactions = [
+    ([0x10, 0x11, 0x22, 0x33, 0x44], [None] * 5),                      # Write four registers
+    ([0x90, 0x00, 0x00, 0x00, 0x00], [None, 0x11, 0x22, 0x33, 0x44]),  # Read them back with no dummy byte
+    ([0x82, 0x00, 0x00, 0x00], [None, 0x06, 0x09, 0x0c]),              # Read initial values
+    ([0x3e, 0xaa, 0xbb, 0xcc], [None] * 4),                            # Write across the end of the register file
+    ([0xbf, 0x00, 0x00], [None, 0xbb, 0xcc]),                          # Read across the end
+]
+
+
+class SPISlaveRegisterFileChecker(px.SimThread):
+    """"
+    This simulator thread will act as SPI master, making register reads and
+    writes to a register file slave and checking the data read.
+    """
+    def __init__(self,
+                 sck_port: str,
+                 mosi_port: str,
+                 miso_port: str,
+                 ss_port: str,
+                 spi_mode: int,
+                 kbps: int) -> None:
+        self._miso_port = miso_port
+        self._mosi_port = mosi_port
+        self._sck_port = sck_port
+        self._ss_port = ss_port
+        self._cpol = spi_mode >> 1
+        self._cpha = spi_mode & 1
+        self._kbps = kbps
+
+    def run(self):
+        xsi: px.pyxsim.Xsi = self.xsi
+        xsi.drive_port_pins(self._sck_port, self._cpol)
+        xsi.drive_port_pins(self._ss_port, 1)
+
+        print("SPI register file checker started")
+
+        # some timing constants
+        xsi_tick_freq_hz = float(1e15)
+        nanosecond_ticks = xsi_tick_freq_hz / 1e9
+        microsecond_ticks = xsi_tick_freq_hz / 1e6
+        millisecond_ticks = xsi_tick_freq_hz / 1e3
+        half_clock = millisecond_ticks / (2 * self._kbps)
+
+        # Let the slave start up
+        time_trigger = xsi.get_time() + 10 * microsecond_ticks
+        self.wait_until(time_trigger)
+
+        for mosi_bytes, miso_bytes in transactions:
+            xsi.drive_port_pins(self._ss_port, 0)
+            time_trigger += 2 * microsecond_ticks
+            self.wait_until(time_trigger)
+
+            clock_val = (self._cpol ^ self._cpha) & 1
+            for byte_count, tx_byte in enumerate(mosi_bytes):
+                rx_byte = 0
+                for bit in range(8):
+                    # clock edge and drive data out
+                    xsi.drive_port_pins(self._sck_port, clock_val)
+                    xsi.drive_port_pins(self._mosi_port, (tx_byte >> (7 - bit)) & 1)
+
+                    time_trigger += half_clock
+                    self.wait_until(time_trigger)
+
+                    # clock edge and read data in
+                    xsi.drive_port_pins(self._sck_port, 1 - clock_val)
+                    rx_byte = (rx_byte << 1) + xsi.sample_port_pins(self._miso_port)
+
+                    time_trigger += half_clock
+                    self.wait_until(time_trigger)
+
+                expected = miso_bytes[byte_count]
+                if expected is not None and rx_byte != expected:
+                    print(f"Error: tester MISO got:{rx_byte:02x} expected:{expected:02x} byte_count:{byte_count} at time: {xsi.get_time() / nanosecond_ticks}ns")
+
+            time_trigger += half_clock
+            self.wait_until(time_trigger)
+
+            # Deassert SS and leave time for the application to handle the summary
+            xsi.drive_port_pins(self._sck_port, self._cpol)
+            xsi.drive_port_pins(self._ss_port, 1)
+            time_trigger += 50 * microsecond_ticks
+            self.wait_until(time_trigger)
@@ -0,0 +1,42 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+from pathlib import Path
+import Pyxsim
+import pytest
+from helpers import generate_tests_from_json, print_expected_vs_output
+
+appname = "spi_crc_loopback"
+test_params_file = Path(__file__).parent / f"{appname}/test_params.json"
+
+# Master ports on tile[0] looped back to the slave ports on tile[1], and MISO the other way
+loopback_ports = ["XS1_PORT_1B", "XS1_PORT_1C", "XS1_PORT_1D"]
+loopback = " ".join(f"-port tile[0] {port} 1 0 -port tile[1] {port} 1 0" for port in loopback_ports)
+loopback += " -port tile[1] XS1_PORT_1A 1 0 -port tile[0] XS1_PORT_1A 1 0"
+
+def do_test(capfd, crc, spi_mode, arch, id):
+    id_string = f"{crc}_{spi_mode}_{arch}"
+    filepath = Path(__file__).resolve().parent
+    binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
+    assert binary.exists()
+
+    with open(filepath/f"expected/crc_loopback.expect") as exp:
+        expected = exp.read().splitlines()
+
+    tester = Pyxsim.testers.ComparisonTester(expected,
+                                            regexp = False,
+                                            ordered = True)
+
+    simargs = f"--plugin LoopbackPort.dll '{loopback}'".split()
+
+    Pyxsim.run_on_simulator_(
+        binary,
+        simargs=simargs,
+        do_xe_prebuild = False,
+        capfd=capfd)
+
+    output = print_expected_vs_output(expected, capfd)
+    assert tester.run(output), output
+
+@pytest.mark.parametrize("params", generate_tests_from_json(test_params_file)[0], ids=generate_tests_from_json(test_params_file)[1])
+def test_crc_loopback(capfd, params, request):
+    do_test(capfd, *params, request.node.callspec.id)
@@ -0,0 +1,34 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+from pathlib import Path
+import Pyxsim
+import pytest
+from helpers import generate_tests_from_json, print_expected_vs_output
+
+appname = "spi_flash_cache"
+test_params_file = Path(__file__).parent / f"{appname}/test_params.json"
+
+def do_test(capfd, use_async, arch, id):
+    id_string = f"{use_async}_{arch}"
+    filepath = Path(__file__).resolve().parent
+    binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
+    assert binary.exists()
+
+    with open(filepath/f"expected/flash_cache.expect") as exp:
+        expected = exp.read().splitlines()
+
+    tester = Pyxsim.testers.ComparisonTester(expected,
+                                            regexp = False,
+                                            ordered = True)
+
+    Pyxsim.run_on_simulator_(
+        binary,
+        do_xe_prebuild = False,
+        capfd=capfd)
+
+    output = print_expected_vs_output(expected, capfd)
+    assert tester.run(output), output
+
+@pytest.mark.parametrize("params", generate_tests_from_json(test_params_file)[0], ids=generate_tests_from_json(test_params_file)[1])
+def test_flash_cache(capfd, params, request):
+    do_test(capfd, *params, request.node.callspec.id)
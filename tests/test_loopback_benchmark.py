@@ -0,0 +1,85 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+from pathlib import Path
+import Pyxsim
+import pytest
+from helpers import generate_tests_from_json, write_csv_row, create_if_needed, sort_csv_table
+
+appname = "spi_loopback_benchmark"
+test_params_file = Path(__file__).parent / f"{appname}/test_params.json"
+test_results_file = Path.cwd()/f"logs/{appname}.txt"
+
+# Master ports on tile[0] looped back to the slave ports on tile[1], and MISO the other way
+loopback_ports = ["XS1_PORT_1B", "XS1_PORT_1C", "XS1_PORT_1D"]
+loopback = " ".join(f"-port tile[0] {port} 1 0 -port tile[1] {port} 1 0" for port in loopback_ports)
+loopback += " -port tile[1] XS1_PORT_1A 1 0 -port tile[0] XS1_PORT_1A 1 0"
+
+ref_clock_hz = 100000000
+
+# This logs to a csv file since we don't want to do checking - it's just benchmark results
+class Resultlogger(Pyxsim.testers.ComparisonTester):
+    def __init__(self, id):
+        # Turn ID back into a dict
+        self.result = dict(item.split('=') for item in id.split(', '))
+
+    def run(self, output):
+        # DUT outputs PASS or FAIL:array size:SCLK kHz:transaction time in reference clock ticks
+        for line in output: print(line)
+        best = {}
+        for line in output:
+            if not line.startswith(("PASS:", "FAIL:")):
+                continue
+            verdict, size, speed, ticks = line.split(':')
+            size, speed, ticks = int(size), int(speed), int(ticks)
+            best.setdefault(size, None)
+            if verdict == "PASS" and (best[size] is None or speed > best[size][0]):
+                best[size] = (speed, ticks)
+
+        assert best, "No timing results found"
+
+        for size, result in best.items():
+            row = dict(self.result)
+            row["array_size"] = size
+            if result is None:
+                row["max_verified_kbps"] = 0
+                row["throughput_kbps"] = 0
+                row["latency_ns"] = 0
+            else:
+                speed, ticks = result
+                row["max_verified_kbps"] = speed
+                row["throughput_kbps"] = size * 8 * ref_clock_hz // (ticks * 1000)
+                row["latency_ns"] = ticks * 1000000000 // ref_clock_hz
+            print(row)
+            write_csv_row(test_results_file, row)
+
+@pytest.fixture(scope="module", autouse=True)
+def remove_test_results():
+    create_if_needed(test_results_file.parent)
+    if test_results_file.exists():
+        test_results_file.unlink()
+    yield
+    # Post test cleanup
+    sort_csv_table(test_results_file)
+
+def do_benchmark_loopback(capfd, use_async, spi_mode, transfer_size, arch, id):
+    id_string = f"{use_async}_{spi_mode}_{transfer_size}_{arch}"
+    filepath = Path(__file__).resolve().parent
+    binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
+    assert binary.exists(), f"Binary file {binary} not present - please pre-build"
+
+    tester = Resultlogger(id)
+
+    simargs = f"--plugin LoopbackPort.dll '{loopback}'".split()
+
+    Pyxsim.run_on_simulator_(
+        binary,
+        tester = tester,
+        simargs=simargs,
+        do_xe_prebuild = False,
+        capfd=capfd)
+
+
+@pytest.mark.parametrize("params", generate_tests_from_json(test_params_file)[0], ids=generate_tests_from_json(test_params_file)[1])
+def test_loopback_benchmark(capfd, params, request):
+    do_benchmark_loopback(capfd, *params, request.node.callspec.id)
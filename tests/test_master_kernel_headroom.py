@@ -0,0 +1,147 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+from pathlib import Path
+from collections import Counter
+import re
+import Pyxsim
+import pytest
+from helpers import generate_tests_from_json, write_csv_row, create_if_needed, sort_csv_table
+
+appname = "spi_master_kernel_headroom"
+test_params_file = Path(__file__).parent / f"{appname}/test_params.json"
+test_results_file = Path.cwd()/f"logs/{appname}.txt"
+
+kernel_function = "spi_master_transfer"
+
+# tile[0]@1-P-SI A-.----00080a2c (spi_master_transfer + 0x4c) : out  res[r1], r2 @12345
+trace_line = re.compile(r"^(tile\[\d+\])@(\d+)\S*\s.*?([0-9a-f]{8})\s+\((\S+)\s*\+\s*(\w+)\)\s*:\s*(\w+).*@(\d+)\s*$")
+
+def parse_trace(trace_file):
+    """
+    Returns a list with an entry for each call to the kernel, holding the
+    (pc, function, mnemonic, time) of every instruction executed by the
+    calling thread until the next call or the end of the trace.
+    """
+    thread = None
+    transfers = []
+    with open(trace_file) as f:
+        for line in f:
+            m = trace_line.match(line)
+            if m is None:
+                continue
+            tile, thread_id, pc, function, offset, mnemonic, time = m.groups()
+            if thread is None:
+                if function != kernel_function:
+                    continue
+                thread = (tile, thread_id)
+            elif (tile, thread_id) != thread:
+                continue
+            if function == kernel_function and int(offset, 0) == 0:
+                transfers.append([])
+            if transfers:
+                transfers[-1].append((pc, function, mnemonic, int(time)))
+    return transfers
+
+def measure_headroom(instructions):
+    """
+    Finds the hot loop of one transfer and returns the thread cycle, the
+    mean refill period, the mean busy cycles per refill and the minimum and
+    mean spare cycles per refill, all in simulator cycles.
+
+    The hot loop refills the SCLK port once per iteration, so its out
+    instruction is the one executed most often. The port holds the thread
+    for whatever the iteration leaves of the refill period, so the spare
+    cycles are the period less the cycles spent issuing instructions.
+    """
+    outs = Counter(pc for pc, function, mnemonic, time in instructions
+                   if function == kernel_function and mnemonic == "out")
+    if not outs:
+        return None
+    loop_pc, count = outs.most_common(1)[0]
+    if count < 2:
+        return None
+
+    # Dual issued instructions share a time, so count issue slots by distinct times
+    times = sorted(set(time for pc, function, mnemonic, time in instructions))
+    thread_cycle = Counter(b - a for a, b in zip(times, times[1:])).most_common(1)[0][0]
+
+    refills = [time for pc, function, mnemonic, time in instructions if pc == loop_pc]
+    periods = []
+    spares = []
+    busys = []
+    for start, end in zip(refills, refills[1:]):
+        issues = len([t for t in times if start <= t < end])
+        periods.append(end - start)
+        busys.append(issues * thread_cycle)
+        spares.append(end - start - issues * thread_cycle)
+
+    return {
+        "thread_cycle": thread_cycle,
+        "refill_period": sum(periods) // len(periods),
+        "busy_cycles": sum(busys) // len(busys),
+        "min_spare_cycles": min(spares),
+        "mean_spare_cycles": sum(spares) // len(spares),
+    }
+
+# This logs to a csv file since we don't want to do checking - it's just benchmark results
+class Resultlogger(Pyxsim.testers.ComparisonTester):
+    def __init__(self, id, trace_file):
+        # Turn ID back into a dict
+        self.result = dict(item.split('=') for item in id.split(', '))
+        self.trace_file = trace_file
+
+    def run(self, output):
+        for line in output: print(line)
+        lengths = None
+        for line in output:
+            if line.startswith("lengths:"):
+                lengths = [int(n) for n in line.split(':')[1:]]
+        assert lengths, "No transfer lengths found"
+
+        transfers = parse_trace(self.trace_file)
+        assert len(transfers) == len(lengths), f"Found {len(transfers)} transfers in the trace, expected {len(lengths)}"
+
+        for length, instructions in zip(lengths, transfers):
+            headroom = measure_headroom(instructions)
+            assert headroom, f"No hot loop found for length {length}"
+            row = dict(self.result)
+            row["length"] = length
+            row.update(headroom)
+            print(row)
+            write_csv_row(test_results_file, row)
+
+@pytest.fixture(scope="module", autouse=True)
+def remove_test_results():
+    create_if_needed(test_results_file.parent)
+    if test_results_file.exists():
+        test_results_file.unlink()
+    yield
+    # Post test cleanup
+    sort_csv_table(test_results_file)
+
+def do_benchmark_headroom(capfd, burnt, spi_mode, miso_mosi_enabled, arch, id):
+    id_string = f"{burnt}_{spi_mode}_{miso_mosi_enabled}_{arch}"
+    filepath = Path(__file__).resolve().parent
+    binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
+    assert binary.exists(), f"Binary file {binary} not present - please pre-build"
+
+    trace_file = test_results_file.parent/f"{appname}_{id_string}.trace"
+    tester = Resultlogger(id, trace_file)
+
+    try:
+        Pyxsim.run_on_simulator_(
+            binary,
+            tester = tester,
+            do_xe_prebuild = False,
+            simargs=['--trace-to', str(trace_file)],
+            capfd=capfd)
+    finally:
+        # The trace holds every instruction of every thread, so don't keep it
+        if trace_file.exists():
+            trace_file.unlink()
+
+
+@pytest.mark.parametrize("params", generate_tests_from_json(test_params_file)[0], ids=generate_tests_from_json(test_params_file)[1])
+def test_master_kernel_headroom(capfd, params, request):
+    do_benchmark_headroom(capfd, *params, request.node.callspec.id)
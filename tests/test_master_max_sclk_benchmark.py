@@ -0,0 +1,76 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+from pathlib import Path
+import Pyxsim
+import pytest
+from spi_master_checker import SPIMasterChecker
+from helpers import generate_tests_from_json, write_csv_row, create_if_needed, sort_csv_table
+
+appname = "spi_master_max_sclk_benchmark"
+test_params_file = Path(__file__).parent / f"{appname}/test_params.json"
+test_results_file = Path.cwd()/f"logs/{appname}.txt"
+
+# The kernels in the order the app reports them
+kernels = ["standard", "sclk_clocked", "expanded"]
+
+# This logs to a csv file since we don't want to do checking - it's just benchmark results
+class Resultlogger(Pyxsim.testers.ComparisonTester):
+    def __init__(self, id):
+        # Turn ID back into a dict
+        self.result = dict(item.split('=') for item in id.split(', '))
+
+    def run(self, output):
+        max_speed = {}
+        for line in output: print(line)
+        for line in output:
+            if not line.startswith("testing:") or "PASS" not in line:
+                continue
+            # testing:kernel:speed:PASS:timing_errors:effective_khz
+            fields = line.split(':')
+            kernel, speed, effective = fields[1], int(fields[2]), int(fields[-1])
+            if kernel not in max_speed or speed > max_speed[kernel][0]:
+                max_speed[kernel] = (speed, effective)
+        for kernel in kernels:
+            assert kernel in max_speed, f"No timing results found for {kernel}"
+            self.result[f"{kernel}_khz"] = max_speed[kernel][0]
+            self.result[f"{kernel}_effective_khz"] = max_speed[kernel][1]
+
+        print(self.result)
+        write_csv_row(test_results_file, self.result)
+
+@pytest.fixture(scope="module", autouse=True)
+def remove_test_results():
+    create_if_needed(test_results_file.parent)
+    if test_results_file.exists():
+        test_results_file.unlink()
+    yield
+    # Post test cleanup
+    sort_csv_table(test_results_file)
+
+def do_benchmark(capfd, spi_mode, miso_mosi_enabled, arch, id):
+    id_string = f"{spi_mode}_{miso_mosi_enabled}_{arch}"
+    filepath = Path(__file__).resolve().parent
+    binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
+    assert binary.exists(), f"Binary file {binary} not present - please pre-build"
+
+    checker = SPIMasterChecker("tile[0]:XS1_PORT_1C",
+                               "tile[0]:XS1_PORT_1D",
+                               "tile[0]:XS1_PORT_1A",
+                               "tile[0]:XS1_PORT_1B",
+                               "tile[0]:XS1_PORT_1E",
+                               "tile[0]:XS1_PORT_16B")
+
+    tester = Resultlogger(id)
+
+    Pyxsim.run_on_simulator_(
+        binary,
+        tester = tester,
+        do_xe_prebuild = False,
+        simthreads = [checker],
+        capfd=capfd)
+
+
+@pytest.mark.parametrize("params", generate_tests_from_json(test_params_file)[0], ids=generate_tests_from_json(test_params_file)[1])
+def test_master_max_sclk_benchmark(capfd, params, request):
+    do_benchmark(capfd, *params, request.node.callspec.id)
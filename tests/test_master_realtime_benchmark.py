@@ -0,0 +1,61 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+
+from pathlib import Path
+import Pyxsim
+import pytest
+from helpers import generate_tests_from_json, write_csv_row, create_if_needed, sort_csv_table
+
+appname = "spi_master_realtime_benchmark"
+test_params_file = Path(__file__).parent / f"{appname}/test_params.json"
+test_results_file = Path.cwd()/f"logs/{appname}.txt"
+
+# This logs to a csv file since we don't want to do checking - it's just benchmark results
+class Resultlogger(Pyxsim.testers.ComparisonTester):
+    def __init__(self, id):
+        # Turn ID back into a dict
+        self.result = dict(item.split('=') for item in id.split(', '))
+
+    def run(self, output):
+        # DUT outputs RESULT:realtime:speed kHz:CS lateness:SCLK lateness:timing errors
+        for line in output: print(line)
+        results = [line.split(':')[1:] for line in output if line.startswith("RESULT:")]
+        assert results, "No timing results found"
+
+        for realtime, speed, cs_ticks, sclk_ticks, errors in results:
+            row = dict(self.result)
+            row["realtime"] = int(realtime)
+            row["speed_kbps"] = int(speed)
+            row["cs_late_ns"] = int(cs_ticks) * 10
+            row["sclk_late_half_periods"] = int(sclk_ticks)
+            row["timing_errors"] = int(errors)
+            print(row)
+            write_csv_row(test_results_file, row)
+
+@pytest.fixture(scope="module", autouse=True)
+def remove_test_results():
+    create_if_needed(test_results_file.parent)
+    if test_results_file.exists():
+        test_results_file.unlink()
+    yield
+    # Post test cleanup
+    sort_csv_table(test_results_file)
+
+def do_benchmark_realtime(capfd, burnt, arch, id):
+    id_string = f"{burnt}_{arch}"
+    filepath = Path(__file__).resolve().parent
+    binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
+    assert binary.exists(), f"Binary file {binary} not present - please pre-build"
+
+    tester = Resultlogger(id)
+
+    Pyxsim.run_on_simulator_(
+        binary,
+        tester = tester,
+        do_xe_prebuild = False,
+        capfd=capfd)
+
+
+@pytest.mark.parametrize("params", generate_tests_from_json(test_params_file)[0], ids=generate_tests_from_json(test_params_file)[1])
+def test_master_realtime_benchmark(capfd, params, request):
+    do_benchmark_realtime(capfd, *params, request.node.callspec.id)
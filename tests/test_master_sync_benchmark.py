@@ -21,10 +21,14 @@ class Resultlogger(Pyxsim.testers.ComparisonTester):
         ignore_list = ["SPI Master checker", "MISO delay setting"]
         result_8b = None
         result_32b = None
+        undetected_fails = 0
         for line in output: print(line)
         for line in reversed(output):
             if any(skip in line for skip in ignore_list):
                 continue
+            # A failure the master did not flag as a timing error is silent corruption
+            if "FAIL" in line and int(line.split(':')[-1]) == 0:
+                undetected_fails += 1
             if "PASS" in line:
                 width, speed = line.split(':')[1:3]
                 if int(width) == 8 and result_8b is None:
@@ -34,6 +38,7 @@ class Resultlogger(Pyxsim.testers.ComparisonTester):
                     result_32b = speed
         self.result["result_8b"] = result_8b
         self.result["result_32b"] = result_32b
+        self.result["undetected_fails"] = undetected_fails
         assert result_8b and result_32b, "No timing results found"
 
         print(self.result)
@@ -48,8 +53,8 @@ def remove_test_results():
     # Post test cleanup
     sort_csv_table(test_results_file)
 
-def do_benchmark_sync(capfd, burnt, spi_mode, miso_mosi_enabled, cb_enabled, arch, id):
-    id_string = f"{burnt}_{spi_mode}_{miso_mosi_enabled}_{cb_enabled}_{arch}"
+def do_benchmark_sync(capfd, rx_drain, burnt, spi_mode, miso_mosi_enabled, cb_enabled, arch, id):
+    id_string = f"{rx_drain}_{burnt}_{spi_mode}_{miso_mosi_enabled}_{cb_enabled}_{arch}"
     filepath = Path(__file__).resolve().parent
     binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
     assert binary.exists(), f"Binary file {binary} not present - please pre-build"
@@ -47,8 +47,8 @@ def remove_test_results():
     # Post test cleanup
     sort_csv_table(test_results_file)
 
-def do_benchmark_slave(capfd, combined, burnt, miso_enabled, spi_mode, transfer_size, arch, id):
-    id_string = f"{combined}_{burnt}_{miso_enabled}_{spi_mode}_{transfer_size}_{arch}"
+def do_benchmark_slave(capfd, combined, burnt, miso_enabled, spi_mode, transfer_size, prearm, arch, id):
+    id_string = f"{combined}_{burnt}_{miso_enabled}_{spi_mode}_{transfer_size}_{prearm}_{arch}"
     filepath = Path(__file__).resolve().parent
     binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
     assert binary.exists()
@@ -9,8 +9,69 @@ from helpers import generate_tests_from_json, create_if_needed, print_expected_v
 appname = "spi_slave_rx_tx"
 test_params_file = Path(__file__).parent / f"{appname}/test_params.json"
 
-def do_slave_rx_tx(capfd, combined, burnt, miso_enabled, spi_mode, transfer_size, arch, id):
-    id_string = f"{combined}_{burnt}_{miso_enabled}_{spi_mode}_{transfer_size}_{arch}"
+class SecondSlaveDriver(Pyxsim.SimThread):
+    """
+    Drives mode 3, 32-bit transactions on the second slave instance of the
+    COMBINED=2 profile while the instance under test is being checked, and
+    checks the words it sends back. The words match SECOND_MOSI_WORD and
+    SECOND_MISO_WORD in spi_slave_rx_tx.xc.
+    """
+    transactions = 4
+    words = 2
+    kbps = 500
+
+    def __init__(self, sck_port, mosi_port, miso_port, ss_port):
+        self._sck_port = sck_port
+        self._mosi_port = mosi_port
+        self._miso_port = miso_port
+        self._ss_port = ss_port
+
+    def run(self):
+        xsi = self.xsi
+        microsecond_ticks = float(1e15) / 1e6
+        half_clock = 1e3 * microsecond_ticks / (2 * self.kbps)
+
+        xsi.drive_port_pins(self._ss_port, 1)
+        xsi.drive_port_pins(self._sck_port, 1)
+
+        time_trigger = xsi.get_time() + 50 * microsecond_ticks
+        self.wait_until(time_trigger)
+
+        for t in range(self.transactions):
+            xsi.drive_port_pins(self._ss_port, 0)
+            time_trigger += 2 * microsecond_ticks
+            self.wait_until(time_trigger)
+
+            for n in range(self.words):
+                mosi_word = 0xa5000000 | (t << 8) | n
+                miso_word = 0
+                for bit in range(31, -1, -1):
+                    # Mode 3: drive on the falling edge, sample on the rising edge
+                    xsi.drive_port_pins(self._sck_port, 0)
+                    xsi.drive_port_pins(self._mosi_port, (mosi_word >> bit) & 1)
+                    time_trigger += half_clock
+                    self.wait_until(time_trigger)
+
+                    xsi.drive_port_pins(self._sck_port, 1)
+                    miso_word = (miso_word << 1) | xsi.sample_port_pins(self._miso_port)
+                    time_trigger += half_clock
+                    self.wait_until(time_trigger)
+
+                expected = 0x5a000000 | (t << 8) | n
+                if miso_word != expected:
+                    print(f"Error: second slave MISO got:{miso_word:08x} expected:{expected:08x}", flush=True)
+
+            time_trigger += half_clock
+            self.wait_until(time_trigger)
+            xsi.drive_port_pins(self._ss_port, 1)
+            time_trigger += 20 * microsecond_ticks
+            self.wait_until(time_trigger)
+
+def do_slave_rx_tx(capfd, combined, burnt, miso_enabled, stream, spi_mode, transfer_size, arch, id):
+    if stream and 128 % transfer_size:
+        pytest.skip("Streaming requires a transfer size which divides the frame")
+
+    id_string = f"{combined}_{burnt}_{miso_enabled}_{stream}_{spi_mode}_{transfer_size}_{arch}"
     filepath = Path(__file__).resolve().parent
     binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
     assert binary.exists()
@@ -23,9 +84,16 @@ def do_slave_rx_tx(capfd, combined, burnt, miso_enabled, spi_mode, transfer_size
                                "tile[0]:XS1_PORT_16B",
                                "tile[0]:XS1_PORT_1F")
 
+    simthreads = [checker]
+    if combined == 2:
+        simthreads.append(SecondSlaveDriver("tile[0]:XS1_PORT_1G",
+                                            "tile[0]:XS1_PORT_1H",
+                                            "tile[0]:XS1_PORT_1I",
+                                            "tile[0]:XS1_PORT_1J"))
+
     with open(filepath/f"expected/slave.expect") as exp:
         expected = exp.read().splitlines()
-        expected = expected[:3 + transfer_size] + expected[-1:]
+        expected = expected[:3 + transfer_size] + expected[-2:]
 
     tester = Pyxsim.testers.ComparisonTester(expected,
                                             regexp = True,
@@ -35,7 +103,7 @@ def do_slave_rx_tx(capfd, combined, burnt, miso_enabled, spi_mode, transfer_size
         binary,
         # simargs=['--vcd-tracing', '-o ./trace.vcd -tile tile[0] -ports -pads -functions'],
         do_xe_prebuild = False,
-        simthreads = [checker],
+        simthreads = simthreads,
         capfd=capfd
         )
 
@@ -0,0 +1,74 @@
+# Copyright 2025 XMOS LIMITED.
+# This Software is subject to the terms of the XMOS Public Licence: Version 1.
+from pathlib import Path
+import Pyxsim
+import pytest
+from spi_slave_checker_throughput import SPISlaveThroughputChecker
+from helpers import generate_tests_from_json, write_csv_row, create_if_needed, sort_csv_table
+
+appname = "spi_slave_throughput_benchmark"
+test_params_file = Path(__file__).parent / f"{appname}/test_params.json"
+test_results_file = Path.cwd()/f"logs/{appname}.txt"
+
+# This logs to a csv file since we don't want to do checking - it's just benchmark results
+class Resultlogger(Pyxsim.testers.ComparisonTester):
+    def __init__(self, id, transfer_size):
+        # Turn ID back into a dict
+        self.result = dict(item.split('=') for item in id.split(', '))
+        self.transfer_size = transfer_size
+
+    def run(self, output):
+        # Checker outputs RESULT: burst kbps, gap test kbps, minimum gap in ns
+        for line in output:
+            print(line)
+        result = None
+        for line in output:
+            if line.startswith("RESULT:"):
+                result = [int(x) for x in line.split(' ')[1:]]
+
+        assert result, "No timing results found"
+
+        burst_kbps, gap_kbps, gap_ns = result
+        self.result["BURST_KBPS"] = burst_kbps
+        # Each word is one master_supplied_data() and one master_requires_data() callback
+        self.result["WORDS_PER_SEC"] = burst_kbps * 1000 // self.transfer_size
+        self.result["GAP_KBPS"] = gap_kbps
+        self.result["MIN_GAP_NS"] = gap_ns
+        write_csv_row(test_results_file, self.result)
+
+@pytest.fixture(scope="module", autouse=True)
+def remove_test_results():
+    create_if_needed(test_results_file.parent)
+    if test_results_file.exists():
+        test_results_file.unlink()
+    yield
+    # Post test cleanup
+    sort_csv_table(test_results_file)
+
+def do_benchmark_slave_throughput(capfd, combined, load, spi_mode, transfer_size, arch, id):
+    id_string = f"{combined}_{load}_{spi_mode}_{transfer_size}_{arch}"
+    filepath = Path(__file__).resolve().parent
+    binary = filepath/f"{appname}/bin/{id_string}/{appname}_{id_string}.xe"
+    assert binary.exists()
+
+    checker = SPISlaveThroughputChecker("tile[0]:XS1_PORT_1C",
+                                        "tile[0]:XS1_PORT_1D",
+                                        "tile[0]:XS1_PORT_1A",
+                                        "tile[0]:XS1_PORT_1B",
+                                        "tile[0]:XS1_PORT_16B",
+                                        "tile[0]:XS1_PORT_1F",
+                                        spi_mode)
+
+    tester = Resultlogger(id, transfer_size)
+
+    Pyxsim.run_on_simulator_(
+        binary,
+        tester = tester,
+        do_xe_prebuild = False,
+        simthreads = [checker],
+        capfd=capfd
+        )
+
+@pytest.mark.parametrize("params", generate_tests_from_json(test_params_file)[0], ids=generate_tests_from_json(test_params_file)[1])
+def test_slave_throughput_benchmark(capfd, params, request):
+    do_benchmark_slave_throughput(capfd, *params, request.node.callspec.id)